@@ -2,6 +2,13 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord;
+#ifdef INSTANCED
+//per instance data from the instance buffer (InstanceTransform in VertexFormat.h)
+layout (location = 3) in mat4 aModelMatrix;		//takes locations 3 - 6
+layout (location = 7) in mat3 aNormalMatrix;	//takes locations 7 - 9
+layout (location = 10) in vec4 aPositionScale;
+layout (location = 11) in vec4 aPositionOffset;
+#endif
 
 //OUTPUTS
 out vec2 textureOutput;
@@ -9,16 +16,48 @@ out vec3 normalOutput;
 out vec3 fragPosOutput;
 
 //UNIFORMS
+#ifndef INSTANCED
 uniform mat4 u_modelMatrix;
-uniform mat4 u_viewMatrix;
-uniform mat4 u_projectionMatrix;
+#ifdef QUANTIZED_POSITIONS
+//packed meshes store positions as -1..1 inside their bounding box
+uniform vec3 u_positionScale;
+uniform vec3 u_positionOffset;
+#endif
+#endif
+
+//per frame camera data shared by every program (binding point 0)
+layout (std140) uniform FrameData {
+	mat4 u_projectionMatrix;
+	mat4 u_viewMatrix;
+	vec3 u_viewPosition;
+};
 
 void main()
 {
+#ifdef INSTANCED
+	mat4 modelMatrix = aModelMatrix;
+	mat3 normalMatrix = aNormalMatrix;
+	vec3 positionScale = aPositionScale.xyz;
+	vec3 positionOffset = aPositionOffset.xyz;
+#else
+	mat4 modelMatrix = u_modelMatrix;
+	mat3 normalMatrix = mat3(transpose(inverse(modelMatrix)));		//expensive ass shit
+#ifdef QUANTIZED_POSITIONS
+	vec3 positionScale = u_positionScale;
+	vec3 positionOffset = u_positionOffset;
+#endif
+#endif
+
 	//------- phong shading (calculating the lighting in the fragment shader) -------
+#ifdef QUANTIZED_POSITIONS
+	vec3 position = aPos * positionScale + positionOffset;
+#else
+	vec3 position = aPos;
+#endif
+
 	textureOutput = aTexCoord;
-	fragPosOutput = vec3(u_modelMatrix * vec4(aPos, 1.0f));
-	normalOutput = mat3(transpose(inverse(u_modelMatrix))) * aNormal;		//expensive ass shit
+	fragPosOutput = vec3(modelMatrix * vec4(position, 1.0f));
+	normalOutput = normalMatrix * aNormal;
 
 	//reading the multiplication from right to left
 	gl_Position = u_projectionMatrix * u_viewMatrix * vec4(fragPosOutput, 1.0f);
@@ -1,18 +1,29 @@
-
 #version 330 core
 
-//defining how many point lights will exist in the scene
+//shared lighting source, ShaderLibrary injects these defines after the version line for each permutation:
+//	NR_POINT_LIGHTS		how many of the scene's point lights this draw loops over (0 - MAX_POINT_LIGHTS)
+//	HAS_SPECULAR_MAP	the material has a specular map (otherwise the diffuse texture doubles as the specular one)
+//	HAS_EMISSION_MAP	the material has an emission map
+#ifndef NR_POINT_LIGHTS
 #define NR_POINT_LIGHTS 4
+#endif
+
+//size of the point light array in the Lights block (must match MAX_POINT_LIGHTS in UniformBuffer.h)
+#define MAX_POINT_LIGHTS 4
 
 //material properties
 struct Material {
 	sampler2D textureDiffuse1;
+#ifdef HAS_SPECULAR_MAP
 	sampler2D textureSpecular1;
+#endif
+#ifdef HAS_EMISSION_MAP
 	sampler2D textureEmission1;
+#endif
 	float shininess;
 };
 
-//Directional light properties
+//Directional light properties (std140, must match DirLightData in UniformBuffer.h)
 struct DirLight {
 	vec3 direction;
 
@@ -21,33 +32,28 @@ struct DirLight {
 	vec3 specular;
 };
 
-//Point light properties
+//Point light properties (std140, each float fills the padding after the vec3 before it)
 struct PointLight {
 	vec3 position;
-
 	float constant;
-	float linear;
-	float quadratic;
-
 	vec3 ambient;
+	float linear;
 	vec3 diffuse;
+	float quadratic;
 	vec3 specular;
 };
 
-//Spot light properties
+//Spot light properties (std140, same packing as the point light)
 struct SpotLight {
 	vec3 position;
-	vec3 direction;
-
 	float constant;
-    float linear;
-    float quadratic;
-
+	vec3 direction;
+	float linear;
 	vec3 ambient;
+	float quadratic;
 	vec3 diffuse;
-	vec3 specular;
-
 	float cutOff;
+	vec3 specular;
 	float outerCutOff;
 };
 
@@ -60,11 +66,28 @@ in vec2 textureOutput;
 out vec4 FragColor;
 
 //UNIFORMS
-uniform vec3 u_viewPosition;
 uniform Material u_material;
-uniform DirLight u_dirLight;
-uniform PointLight u_pointLight[NR_POINT_LIGHTS];		//based on the definition of point lights 
-uniform SpotLight u_spotLight;
+#if NR_POINT_LIGHTS > 0
+uniform ivec4 u_pointLightIndices;		//which lights of the Lights block affect this draw
+#endif
+
+//per frame camera data shared by every program (binding point 0)
+layout (std140) uniform FrameData {
+	mat4 u_projectionMatrix;
+	mat4 u_viewMatrix;
+	vec3 u_viewPosition;
+};
+
+//scene lights shared by every program (binding point 1)
+layout (std140) uniform Lights {
+	DirLight u_dirLight;
+	PointLight u_pointLight[MAX_POINT_LIGHTS];
+	SpotLight u_spotLight;
+};
+
+//material colours, sampled once per fragment instead of once per light
+vec3 diffuseColor;
+vec3 specularColor;
 
 //FUNCTION PROTOTYPES
 vec3 CalculateDirectionalLight(DirLight u_dirLight, vec3 norm, vec3 viewDirection);
@@ -73,6 +96,13 @@ vec3 CaluclateSpotLight(SpotLight u_spotLight, vec3 norm, vec3 fragPosOutput, ve
 
 void main ()
 {
+	diffuseColor = vec3(texture(u_material.textureDiffuse1, textureOutput));
+#ifdef HAS_SPECULAR_MAP
+	specularColor = vec3(texture(u_material.textureSpecular1, textureOutput));
+#else
+	specularColor = diffuseColor;
+#endif
+
 	//Calulating lighting properties (PHONG SHADING)
 	vec3 norm = normalize(normalOutput);
 	vec3 viewDirection = normalize(u_viewPosition - fragPosOutput);
@@ -80,44 +110,43 @@ void main ()
 	//Phase 1: Directional Lighting
 	vec3 result = CalculateDirectionalLight(u_dirLight, norm, viewDirection);
 
-	//Phase 2: Point Lighting
+	//Phase 2: Point Lighting (only the lights selected for this draw)
+#if NR_POINT_LIGHTS > 0
 	for (int i = 0; i < NR_POINT_LIGHTS; i++){
-		result += CalculatePointLight(u_pointLight[i], norm, fragPosOutput, viewDirection);
+		result += CalculatePointLight(u_pointLight[u_pointLightIndices[i]], norm, fragPosOutput, viewDirection);
 	}
+#endif
 
 	//Phase 3: Spot Lighting
 	result += CaluclateSpotLight(u_spotLight, norm, fragPosOutput, viewDirection);
 
-
 	//Phase 4: Emission handling
+#ifdef HAS_EMISSION_MAP
 	vec3 emissionMap = vec3(texture(u_material.textureEmission1, textureOutput));
-	vec3 specularMap = vec3(texture(u_material.textureSpecular1, textureOutput));
-	if (specularMap.r == 0.0 && specularMap.g == 0.0 && specularMap.b == 0.0) {
+	if (specularColor.r == 0.0 && specularColor.g == 0.0 && specularColor.b == 0.0) {
 		result += emissionMap;
 	}
-
+#endif
 
 	//Applying all lighting calculations
 	FragColor = vec4(result, 1.0);
 }
 
-
-
 //for calculating any directional lighting in the scene
 vec3 CalculateDirectionalLight(DirLight u_dirLight, vec3 norm, vec3 viewDirection){
 	//getting light direction using the direction
 	vec3 lightDirecton = normalize(-u_dirLight.direction);												//normalizing the negative of dirLight's direction attribute
-	
-	//diffuse 
+
+	//diffuse
 	float diff = max(dot(norm, lightDirecton), 0.0f);													//calculating diffuse with dot product of normals and lightDirection
 	//specular
 	vec3 reflectDirection = reflect(-lightDirecton, norm);												//getting the reflect direction based on the negative lightDirection and the normals
 	float spec = pow(max(dot(viewDirection, reflectDirection), 0.0f), u_material.shininess);			//calculating specular with power based on shininess, dot prod on view + ref directions
 
 	//combining results
-	vec3 ambient = u_dirLight.ambient * vec3(texture(u_material.textureDiffuse1, textureOutput));				//light ambient multiplied with material diffuse's texture
-	vec3 diffuse = u_dirLight.diffuse * diff * vec3(texture(u_material.textureDiffuse1, textureOutput));		//light diffuse multiplied with material diffuse's texture
-	vec3 specular = u_dirLight.specular * spec * vec3(texture(u_material.textureSpecular1, textureOutput));		//light specular multiplied with material specular's texture
+	vec3 ambient = u_dirLight.ambient * diffuseColor;						//light ambient multiplied with material diffuse's texture
+	vec3 diffuse = u_dirLight.diffuse * diff * diffuseColor;				//light diffuse multiplied with material diffuse's texture
+	vec3 specular = u_dirLight.specular * spec * specularColor;				//light specular multiplied with material specular's texture
 
 	//returning vec3 result
 	return (ambient + diffuse + specular);
@@ -141,9 +170,9 @@ vec3 CalculatePointLight(PointLight u_pointLight, vec3 norm, vec3 fragPosOutput,
 	float attenuation = 1.0f / (u_pointLight.constant + u_pointLight.linear * distance + u_pointLight.quadratic * (distance * distance));
 
 	//combining results
-	vec3 ambient = u_pointLight.ambient * vec3(texture(u_material.textureDiffuse1, textureOutput));
-	vec3 diffuse = u_pointLight.diffuse * diff * vec3(texture(u_material.textureDiffuse1, textureOutput));
-	vec3 specular = u_pointLight.specular * spec * vec3(texture(u_material.textureSpecular1, textureOutput));
+	vec3 ambient = u_pointLight.ambient * diffuseColor;
+	vec3 diffuse = u_pointLight.diffuse * diff * diffuseColor;
+	vec3 specular = u_pointLight.specular * spec * specularColor;
 
 	//applying attenuation to lighting vectors
 	ambient *= attenuation;
@@ -173,13 +202,13 @@ vec3 CaluclateSpotLight(SpotLight u_spotLight, vec3 norm, vec3 fragPosOutput, ve
 	float intensity = clamp((theta - u_spotLight.outerCutOff) / epsilon, 0.0f, 1.0f);		//clamping the values between 0 and 1
 
 	//applying spotlight
-	vec3 ambient = u_spotLight.ambient * vec3(texture(u_material.textureDiffuse1, textureOutput));
-	vec3 diffuse = u_spotLight.diffuse * diff * vec3(texture(u_material.textureDiffuse1, textureOutput));
-	vec3 specular = u_spotLight.specular * spec * vec3(texture(u_material.textureSpecular1, textureOutput));
+	vec3 ambient = u_spotLight.ambient * diffuseColor;
+	vec3 diffuse = u_spotLight.diffuse * diff * diffuseColor;
+	vec3 specular = u_spotLight.specular * spec * specularColor;
 
 	ambient *= attenuation * intensity;
 	diffuse *= attenuation * intensity;
 	specular *= attenuation * intensity;
 
 	return (ambient + diffuse + specular);
-}
\ No newline at end of file
+}
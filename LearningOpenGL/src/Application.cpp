@@ -5,9 +5,21 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <iostream>
+#include <chrono>
 #include "Shader.h"
+#include "ShaderLibrary.h"
 #include "Model.h"
+#include "Material.h"
+#include "Primitives.h"
+#include "SceneBVH.h"
+#include "OcclusionCuller.h"
 #include "Camera.h"
+#include "FrameStats.h"
+#include "UniformBuffer.h"
+#include "GLState.h"
+#include "DrawBatch.h"
+#include "InstanceBatch.h"
+#include "StreamBuffer.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -18,12 +30,55 @@ void processInput(GLFWwindow* window);
 void mouse_callback(GLFWwindow* window, double xPos, double yPos);
 void scroll_callback(GLFWwindow* window, double xOffset, double yOffset);
 unsigned int loadTexture(const char* path);
-void loadLighting(Shader &shader);
+void updateLights(LightsBlock &lights);
+LightSelection lightsForSphere(const glm::mat4 &modelMatrix, const glm::vec3 &center, float radius);
 
 //window settings
 const unsigned int SCREEN_WIDTH = 1280;
 const unsigned int SCREEN_HEIGHT = 720;
 const float ASPECT_RATIO = static_cast<float>(SCREEN_WIDTH) / SCREEN_HEIGHT;
+const float CUBE_RADIUS = 0.866f;		//bounding sphere of the unit cube (half its diagonal)
+const glm::vec3 LOADING_PROXY_COLOR = glm::vec3(0.3f);		//unit cubes standing in for models still loading
+
+//GPU vertex layout of the loaded models (switch to VERTEX_FORMAT_FULL to compare memory + throughput)
+const vertex_format MODEL_VERTEX_FORMAT = VERTEX_FORMAT_PACKED;
+
+//draw submission benchmark: B cycles how many extra blahajs get drawn, M how the models get submitted
+enum submission_mode {
+	SUBMIT_PER_OBJECT,				//one glDraw* per mesh (or per meshlet list) with uniforms in between
+	SUBMIT_MULTI_DRAW_INDIRECT,		//DrawBatch with one glMultiDrawElementsIndirect per state group (GL 4.3)
+	SUBMIT_MULTI_DRAW_FALLBACK,		//DrawBatch forced onto the GL 3.3 glMultiDrawElementsBaseVertex path
+	SUBMIT_INSTANCED				//benchmark blahajs as one InstanceBatch, one glDrawElementsInstanced per mesh and LOD
+};
+submission_mode submissionMode = SUBMIT_MULTI_DRAW_INDIRECT;
+const unsigned int BENCHMARK_COUNTS[] = { 0, 100, 1000, 10000, 100000 };
+const unsigned int BENCHMARK_ROW = 320;		//blahajs per row of the benchmark grid
+unsigned int benchmarkLevel = 0;
+bool occlusionCulling = true;		//O toggles testing objects against the software occlusion buffer
+
+//every renderable instance is a leaf of the scene tree, the leaf's user value being its index into the scene objects
+enum scene_object_type {
+	OBJECT_CONTAINER,
+	OBJECT_EMISSION_CUBE,
+	OBJECT_BACKPACK,
+	OBJECT_BLAHAJ,
+	OBJECT_LIGHT_CUBE,
+	OBJECT_BENCHMARK_BLAHAJ,		//kept last, they are the only objects whose leaves never move
+	OBJECT_TYPE_COUNT
+};
+struct SceneObject {
+	scene_object_type type;
+	unsigned int index;			//which one of its type (into cubePositions, blahajPositions, ...)
+	unsigned int proxy;			//its leaf in the scene tree
+	glm::mat4 modelMatrix;
+};
+//query results of the camera collision, kept across frames so it does not allocate every frame
+struct CameraCollision {
+	std::vector<unsigned int> nearby;
+	std::vector<TriangleBVH::SphereContact> contacts;
+};
+glm::mat4 sceneObjectModel(scene_object_type type, unsigned int index, float time);
+void collideCamera(CameraCollision& collision, SceneBVH& sceneTree, const std::vector<SceneObject>& sceneObjects, const std::vector<const TriangleBVH*> objectCollision[], float time);
 
 float deltaTime = 0.0f;		//time between current and last frame
 float lastFrame = 0.0f;		//time of last frame
@@ -44,6 +99,28 @@ glm::vec3 pointLightColors[]{
 	glm::vec3(0.75f, 0.05f, 0.05f)
 };
 
+//creating the WORLD positions for x cubes that will be rendered - RANDOM POSITIONS
+glm::vec3 cubePositions[] = {
+	glm::vec3(0.0f,  0.0f,  0.0f),
+	glm::vec3(2.0f,  5.0f, -15.0f),
+	glm::vec3(-1.5f, -2.2f, -2.5f),
+	glm::vec3(-3.8f, -2.0f, -12.3f),
+	glm::vec3(2.4f, -0.4f, -3.5f),
+	glm::vec3(-1.7f,  3.0f, -7.5f),
+	glm::vec3(1.3f, -2.0f, -2.5f),
+	glm::vec3(1.5f,  2.0f, -2.5f),
+	glm::vec3(1.5f,  0.2f, -1.5f),
+	glm::vec3(-1.3f,  1.0f, -1.5f)
+};
+
+glm::vec3 blahajPositions[] = {
+	glm::vec3(5.0f, 5.0f, -5.0f),
+	glm::vec3(7.0f, 2.0f, 7.0f),
+	glm::vec3(-6.0f, -1.0f, -5.0f),
+	glm::vec3(4.0f, -3.0f, -1.0f),
+	glm::vec3(5.0f, 0.0f, 5.0f),
+};
+
 //world positions for point lights
 glm::vec3 pointLightPositions[] = {
 	glm::vec3(0.7f,  0.2f,  2.0f),
@@ -52,12 +129,20 @@ glm::vec3 pointLightPositions[] = {
 	glm::vec3(0.0f,  0.0f, -3.0f)
 };
 
+//cpu copy of the Lights block, also used to pick which point lights reach each draw
+LightsBlock sceneLights{};
+
 //setting up camera
 Camera camera(glm::vec3(0.0f, 1.0f, 3.0f));
 float lastX = SCREEN_WIDTH / 2;
 float lastY = SCREEN_HEIGHT / 2;
 bool firstMouse = true;
 
+//FPS mode (E): walking on whatever is below the camera, the floor height being where nothing is
+bool fpsMode = false;
+const float FLOOR_HEIGHT = 0.0f;
+const float GRAVITY = 9.81f;
+
 int main()
 {
 	//initializing GLFW
@@ -92,124 +177,33 @@ int main()
 	//enabling depth testing for z buffers
 	glEnable(GL_DEPTH_TEST);
 
+	//letting the driver compile shaders on background threads if it can
+	Shader::EnableParallelCompile((GLADloadproc)glfwGetProcAddress);
+
 	// BUILDING SHADERS (pathing starts from the solution directory)
-	Shader containerShader("res/shaders/container.vert", "res/shaders/container.frag");
-	Shader lightingShader("res/shaders/container.vert", "res/shaders/lighting.frag");
-	Shader backpackShader("res/shaders/backpack.vert", "res/shaders/backpack.frag");
-	Shader blahajShader("res/shaders/blahaj.vert", "res/shaders/blahaj.frag");
+	std::chrono::steady_clock::time_point startupStart = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point shaderStart = std::chrono::steady_clock::now();
+	//every lit object shares one lighting source, specialised per material and light count
+	ShaderLibrary phongShaders("res/shaders/container.vert", "res/shaders/phong.frag");
+	phongShaders.precompile(FEATURE_SPECULAR_MAP | FEATURE_INSTANCED);		//containers
+	phongShaders.precompile(FEATURE_SPECULAR_MAP | FEATURE_EMISSION_MAP);	//emission cube
 	Shader lightCubeShader("res/shaders/container.vert", "res/shaders/lightCube.frag");
 
+	double shaderSubmitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - shaderStart).count();
+	std::cout << "STARTUP::SHADERS: " << Shader::buildStats().programsBuilt << " programs submitted in " << shaderSubmitMs << " ms" << std::endl;
+
+	//shared uniform blocks, bound once and filled once per frame for every program
+	UniformBuffer frameDataBuffer(sizeof(FrameDataBlock), FRAME_DATA_BINDING);
+	UniformBuffer lightsBuffer(sizeof(LightsBlock), LIGHTS_BINDING);
+
 	//LOADING MODELS
-	Model backpack("res/models/backpack/backpack.obj", true);
-	Model blahaj("res/models/blahaj/blahaj.obj", false);
-
-	//cube data
-	float cubeVertices[] = {			//with positions, normals and textures
-		// Back face
-		-0.5f, -0.5f, -0.5f,   0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
-		 0.5f, -0.5f, -0.5f,   0.0f,  0.0f, -1.0f,  1.0f, 0.0f,
-		 0.5f,  0.5f, -0.5f,   0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
-		 0.5f,  0.5f, -0.5f,   0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
-		-0.5f,  0.5f, -0.5f,   0.0f,  0.0f, -1.0f,  0.0f, 1.0f,
-		-0.5f, -0.5f, -0.5f,   0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
-
-		// Front face
-		-0.5f, -0.5f,  0.5f,   0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
-		 0.5f, -0.5f,  0.5f,   0.0f,  0.0f, 1.0f,   1.0f, 0.0f,
-		 0.5f,  0.5f,  0.5f,   0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
-		 0.5f,  0.5f,  0.5f,   0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
-		-0.5f,  0.5f,  0.5f,   0.0f,  0.0f, 1.0f,   0.0f, 1.0f,
-		-0.5f, -0.5f,  0.5f,   0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
-
-		// Left face
-		-0.5f,  0.5f,  0.5f,  -1.0f,  0.0f, 0.0f,   1.0f, 0.0f,
-		-0.5f,  0.5f, -0.5f,  -1.0f,  0.0f, 0.0f,   1.0f, 1.0f,
-		-0.5f, -0.5f, -0.5f,  -1.0f,  0.0f, 0.0f,   0.0f, 1.0f,
-		-0.5f, -0.5f, -0.5f,  -1.0f,  0.0f, 0.0f,   0.0f, 1.0f,
-		-0.5f, -0.5f,  0.5f,  -1.0f,  0.0f, 0.0f,   0.0f, 0.0f,
-		-0.5f,  0.5f,  0.5f,  -1.0f,  0.0f, 0.0f,   1.0f, 0.0f,
-
-		// Right face
-		 0.5f,  0.5f,  0.5f,   1.0f,  0.0f, 0.0f,   1.0f, 0.0f,
-		 0.5f,  0.5f, -0.5f,   1.0f,  0.0f, 0.0f,   1.0f, 1.0f,
-		 0.5f, -0.5f, -0.5f,   1.0f,  0.0f, 0.0f,   0.0f, 1.0f,
-		 0.5f, -0.5f, -0.5f,   1.0f,  0.0f, 0.0f,   0.0f, 1.0f,
-		 0.5f, -0.5f,  0.5f,   1.0f,  0.0f, 0.0f,   0.0f, 0.0f,
-		 0.5f,  0.5f,  0.5f,   1.0f,  0.0f, 0.0f,   1.0f, 0.0f,
-
-		 // Bottom face
-		 -0.5f, -0.5f, -0.5f,   0.0f, -1.0f, 0.0f,   0.0f, 1.0f,
-		  0.5f, -0.5f, -0.5f,   0.0f, -1.0f, 0.0f,   1.0f, 1.0f,
-		  0.5f, -0.5f,  0.5f,   0.0f, -1.0f, 0.0f,   1.0f, 0.0f,
-		  0.5f, -0.5f,  0.5f,   0.0f, -1.0f, 0.0f,   1.0f, 0.0f,
-		 -0.5f, -0.5f,  0.5f,   0.0f, -1.0f, 0.0f,   0.0f, 0.0f,
-		 -0.5f, -0.5f, -0.5f,   0.0f, -1.0f, 0.0f,   0.0f, 1.0f,
-
-		 // Top face
-		 -0.5f,  0.5f, -0.5f,   0.0f,  1.0f, 0.0f,   0.0f, 1.0f,
-		  0.5f,  0.5f, -0.5f,   0.0f,  1.0f, 0.0f,   1.0f, 1.0f,
-		  0.5f,  0.5f,  0.5f,   0.0f,  1.0f, 0.0f,   1.0f, 0.0f,
-		  0.5f,  0.5f,  0.5f,   0.0f,  1.0f, 0.0f,   1.0f, 0.0f,
-		 -0.5f,  0.5f,  0.5f,   0.0f,  1.0f, 0.0f,   0.0f, 0.0f,
-		 -0.5f,  0.5f, -0.5f,   0.0f,  1.0f, 0.0f,   0.0f, 1.0f
-	};
-
-	//creating the WORLD positions for x cubes that will be rendered - RANDOM POSITIONS
-	glm::vec3 cubePositions[] = {
-		glm::vec3(0.0f,  0.0f,  0.0f),
-		glm::vec3(2.0f,  5.0f, -15.0f),
-		glm::vec3(-1.5f, -2.2f, -2.5f),
-		glm::vec3(-3.8f, -2.0f, -12.3f),
-		glm::vec3(2.4f, -0.4f, -3.5f),
-		glm::vec3(-1.7f,  3.0f, -7.5f),
-		glm::vec3(1.3f, -2.0f, -2.5f),
-		glm::vec3(1.5f,  2.0f, -2.5f),
-		glm::vec3(1.5f,  0.2f, -1.5f),
-		glm::vec3(-1.3f,  1.0f, -1.5f)
-	};
-
-	glm::vec3 blahajPositions[] = {
-		glm::vec3(5.0f, 5.0f, -5.0f),
-		glm::vec3(7.0f, 2.0f, 7.0f),
-		glm::vec3(-6.0f, -1.0f, -5.0f),
-		glm::vec3(4.0f, -3.0f, -1.0f),
-		glm::vec3(5.0f, 0.0f, 5.0f),
-	};
-
-
-
-	//creating an array of vertex objects
-	unsigned int VAO[2], VBO[2], EBO;
-	glGenVertexArrays(2, VAO);
-	glGenBuffers(2, VBO);
-	glGenBuffers(1, &EBO);
-
-
-	//------- 3D RENDERING (CONTAINER)-------
-	glBindVertexArray(VAO[0]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-
-	/*
-	//------- 2D RENDERING (WALL) -------
-	glBindVertexArray(VAO[1]);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(wallVertices), wallVertices, GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(wallIndices), wallIndices, GL_STATIC_DRAW);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	*/
+	//imported in the background, the scene draws a proxy cube for each of them until it is uploaded
+	Model backpack("res/models/backpack/backpack.obj", true, MODEL_VERTEX_FORMAT, MODEL_LOAD_ASYNC);
+	Model blahaj("res/models/blahaj/blahaj.obj", false, MODEL_VERTEX_FORMAT, MODEL_LOAD_ASYNC);
+	std::cout << "DRAW SUBMISSION: glMultiDrawElementsIndirect " << (DrawBatch::indirectSupported() ? "available" : "unavailable, batches use glMultiDrawElementsBaseVertex") << std::endl;
+	DrawBatch drawBatch;
+	InstanceBatch containerInstances;
+	InstanceBatch benchmarkInstances;
 
 	//loading textures
 	unsigned int texture1 = loadTexture("res/textures/container.jpg");
@@ -219,15 +213,37 @@ int main()
 	unsigned int specularMap = loadTexture("res/textures/container2_specular.png");
 	unsigned int emissionMap = loadTexture("res/textures/matrix.jpg");
 
-	//setting texture uniforms
-	containerShader.useProgram();
-	containerShader.setInt("u_material.textureDiffuse1", 0);
-	containerShader.setInt("u_material.textureSpecular1", 1);
-
-	lightingShader.useProgram();
-	lightingShader.setInt("u_material.textureDiffuse1", 0);
-	lightingShader.setInt("u_material.textureSpecular1", 1);
-	lightingShader.setInt("u_material.textureEmission1", 2);
+	//built in cubes, indexed and cache optimised like the model meshes (the light cubes have no textures)
+	Mesh containerCube = Primitives::cube({ { diffuseMap, "textureDiffuse", "" }, { specularMap, "textureSpecular", "" } });
+	Mesh emissionCube = Primitives::cube({ { diffuseMap, "textureDiffuse", "" }, { specularMap, "textureSpecular", "" }, { emissionMap, "textureEmission", "" } });
+	Mesh lightCube = Primitives::cube({});
+
+	//SCENE TREE
+	//model space bounds of every animated object type, the leaves of those get refit every frame
+	//(the models' entries get filled in once they are loaded)
+	glm::vec3 objectCenters[OBJECT_TYPE_COUNT] = { containerCube.boundsCenter, emissionCube.boundsCenter, glm::vec3(0.0f), glm::vec3(0.0f), lightCube.boundsCenter };
+	glm::vec3 objectExtents[OBJECT_TYPE_COUNT] = { containerCube.boundsExtents, emissionCube.boundsExtents, glm::vec3(0.0f), glm::vec3(0.0f), lightCube.boundsExtents };
+	//the benchmark blahajs only spin around their origin, a box around the sphere holding every rotation never moves
+	float benchmarkReach = 0.0f;
+	SceneBVH sceneTree;
+	std::vector<SceneObject> sceneObjects;
+	CameraCollision cameraCollision;
+	unsigned int sceneBenchmarkCount = 0;
+	std::vector<unsigned int> visibleObjects;
+	std::vector<unsigned int> visibleByType[OBJECT_TYPE_COUNT];
+	OcclusionCuller occlusion;
+	std::vector<glm::vec3> occlusionMinimums, occlusionMaximums;
+	std::vector<unsigned char> occlusionVisible;
+	//what the camera collides with per object type, every tree in the object's model space
+	std::vector<const TriangleBVH*> objectCollision[OBJECT_TYPE_COUNT];
+	objectCollision[OBJECT_CONTAINER].push_back(&containerCube.collision);
+	objectCollision[OBJECT_EMISSION_CUBE].push_back(&emissionCube.collision);
+	objectCollision[OBJECT_LIGHT_CUBE].push_back(&lightCube.collision);
+	std::vector<glm::mat4> loadingProxies;
+
+	//startup benchmark: reported once every program has finished compiling in the background
+	bool shadersReported = false;
+	bool firstFrameReported = false;
 
 	//-------------------------------- RENDER LOOP ----------------------------------------
 	while (!glfwWindowShouldClose(window)) {		//checks if glfw has been instructed to close
@@ -235,6 +251,22 @@ int main()
 		float currentFrame = glfwGetTime();
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
+		FrameStats::get().beginFrame();
+		StreamBuffer::get().beginFrame();
+
+		//run twice (or delete cache/shaders) to compare a cold and a warm binary cache
+		if (!shadersReported) {
+			bool allReady = phongShaders.isReady();
+			allReady = lightCubeShader.isReady() && allReady;
+			if (allReady) {
+				double readyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - shaderStart).count();
+				std::cout << "STARTUP::SHADERS: all " << phongShaders.variantCount() + 1 << " programs ready after " << readyMs << " ms ("
+					<< Shader::buildStats().binaryCacheHits << " loaded from the binary cache, "
+					<< Shader::buildStats().stagesCompiled << " stages compiled, "
+					<< Shader::buildStats().compilesAvoided << " compiles avoided by the stage cache)" << std::endl;
+				shadersReported = true;
+			}
+		}
 
 		//getting user input through the application loop
 		processInput(window);
@@ -243,140 +275,266 @@ int main()
 		glClearColor(0.001f, 0.001f, 0.001f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);		//clearing the buffers every iteration
 
+		// ========== BACKGROUND MODEL LOADING ==========
+		//uploading a model whose import finished, then handing its bounds and collision meshes to the scene. until
+		//then a model stands in as a proxy cube, with the proxy's bounds and nothing to collide with
+		if (Model::finishLoads() > 0 || sceneObjects.empty()) {
+			//submitting the permutations the models need (both the uniform and the instanced variant, the submission
+			//mode can be switched at runtime), a model still loading has no features yet
+			for (unsigned int features = 0; features <= FEATURE_ALL; features++) {
+				if ((backpack.featureSets() | blahaj.featureSets()) & (1u << (features & ~FEATURE_INSTANCED)))
+					phongShaders.precompile(features);
+			}
+
+			objectCenters[OBJECT_BACKPACK] = backpack.ready() ? backpack.boundsCenter : lightCube.boundsCenter;
+			objectExtents[OBJECT_BACKPACK] = backpack.ready() ? backpack.boundsExtents : lightCube.boundsExtents;
+			objectCenters[OBJECT_BLAHAJ] = blahaj.ready() ? blahaj.boundsCenter : lightCube.boundsCenter;
+			objectExtents[OBJECT_BLAHAJ] = blahaj.ready() ? blahaj.boundsExtents : lightCube.boundsExtents;
+			benchmarkReach = blahaj.ready() ? glm::length(blahaj.boundsCenter) + blahaj.boundsRadius : CUBE_RADIUS;
+
+			objectCollision[OBJECT_BACKPACK].clear();
+			objectCollision[OBJECT_BLAHAJ].clear();
+			objectCollision[OBJECT_BENCHMARK_BLAHAJ].clear();
+			backpack.collisionMeshes(objectCollision[OBJECT_BACKPACK]);
+			blahaj.collisionMeshes(objectCollision[OBJECT_BLAHAJ]);
+			blahaj.collisionMeshes(objectCollision[OBJECT_BENCHMARK_BLAHAJ]);
+
+			sceneObjects.clear();		//building the tree again with the new bounds
+		}
+
+		// ========== SCENE TREE ==========
+		//building the tree again when the benchmark changes the objects in it
+		if (sceneObjects.empty() || sceneBenchmarkCount != BENCHMARK_COUNTS[benchmarkLevel]) {
+			sceneBenchmarkCount = BENCHMARK_COUNTS[benchmarkLevel];
+			const unsigned int objectCounts[OBJECT_TYPE_COUNT] = { 10, 1, 1, 5, 5, sceneBenchmarkCount };
+			sceneObjects.clear();
+			sceneTree.clear();
+			for (unsigned int type = 0; type < OBJECT_TYPE_COUNT; type++) {
+				for (unsigned int i = 0; i < objectCounts[type]; i++) {
+					SceneObject object;
+					object.type = (scene_object_type)type;
+					object.index = i;
+					object.modelMatrix = sceneObjectModel(object.type, i, currentFrame);
+					glm::vec3 minimum, maximum;
+					if (object.type == OBJECT_BENCHMARK_BLAHAJ) {
+						minimum = glm::vec3(object.modelMatrix[3]) - glm::vec3(benchmarkReach);
+						maximum = glm::vec3(object.modelMatrix[3]) + glm::vec3(benchmarkReach);
+					}
+					else {
+						worldBounds(object.modelMatrix, objectCenters[type], objectExtents[type], minimum, maximum);
+					}
+					object.proxy = sceneTree.insert(minimum, maximum, (unsigned int)sceneObjects.size());
+					sceneObjects.push_back(object);
+				}
+			}
+			sceneTree.rebuild();
+			std::cout << "SCENE TREE: " << sceneTree.size() << " objects, SAH cost " << sceneTree.cost() << std::endl;
+		}
+
+		//animating every cube, blahaj and the backpack, only the nodes above them get refit
+		for (unsigned int i = 0; i < sceneObjects.size() && sceneObjects[i].type != OBJECT_BENCHMARK_BLAHAJ; i++) {
+			SceneObject& object = sceneObjects[i];
+			object.modelMatrix = sceneObjectModel(object.type, object.index, currentFrame);
+			glm::vec3 minimum, maximum;
+			worldBounds(object.modelMatrix, objectCenters[object.type], objectExtents[object.type], minimum, maximum);
+			sceneTree.update(object.proxy, minimum, maximum);
+		}
+		sceneTree.refit();
+
+		//walking into the scene instead of through it
+		if (fpsMode)
+			collideCamera(cameraCollision, sceneTree, sceneObjects, objectCollision, currentFrame);
+
 		//creating matrixes
 		glm::mat4 projectionMatrix = glm::perspective(glm::radians(camera.zoom), ASPECT_RATIO, 0.1f, 100.0f);		//radians = FOV, width/height (aspect ratio), near place and far plane	
 		glm::mat4 cameraView = camera.GetViewMatrix();
 
+		//uploading the camera and lights once for all programs
+		FrameDataBlock frameData{};
+		frameData.projectionMatrix = projectionMatrix;
+		frameData.viewMatrix = cameraView;
+		frameData.viewPosition = camera.position;
+		frameDataBuffer.update(&frameData);
+		updateLights(sceneLights);
+		lightsBuffer.update(&sceneLights);
+
+		//what the models pick their LODs and cull their meshlets against
+		DrawView drawView;
+		drawView.viewProjection = projectionMatrix * cameraView;
+		drawView.position = camera.position;
+		drawView.projectionScale = SCREEN_HEIGHT / (2.0f * glm::tan(glm::radians(camera.zoom) * 0.5f));
+		drawView.frustum = camera.GetFrustum(projectionMatrix);
+
+		//culling the whole scene in one traversal, then grouping what is visible by type
+		visibleObjects.clear();
+		sceneTree.queryFrustum(drawView.frustum, visibleObjects);
+
+		//the cubes and the backpack hide what is behind them, every object still visible gets tested against them
+		if (occlusionCulling && !visibleObjects.empty()) {
+			occlusion.beginFrame(drawView.viewProjection, glm::radians(camera.zoom));
+			for (unsigned int i = 0; i < visibleObjects.size(); i++) {
+				const SceneObject& object = sceneObjects[visibleObjects[i]];
+				if (object.type == OBJECT_CONTAINER)
+					occlusion.addOccluder(object.modelMatrix, containerCube.vertices, containerCube.indices);
+				else if (object.type == OBJECT_EMISSION_CUBE)
+					occlusion.addOccluder(object.modelMatrix, emissionCube.vertices, emissionCube.indices);
+				else if (object.type == OBJECT_BACKPACK)
+					backpack.addOccluders(occlusion, object.modelMatrix, camera.position);
+			}
+			occlusion.rasterize();
+
+			occlusionMinimums.resize(visibleObjects.size());
+			occlusionMaximums.resize(visibleObjects.size());
+			occlusionVisible.resize(visibleObjects.size());
+			for (unsigned int i = 0; i < visibleObjects.size(); i++)
+				sceneTree.bounds(sceneObjects[visibleObjects[i]].proxy, occlusionMinimums[i], occlusionMaximums[i]);
+			occlusion.testBoxes(&occlusionMinimums[0], &occlusionMaximums[0], visibleObjects.size(), &occlusionVisible[0]);
+
+			unsigned int kept = 0;
+			for (unsigned int i = 0; i < visibleObjects.size(); i++) {
+				if (occlusionVisible[i])
+					visibleObjects[kept++] = visibleObjects[i];
+			}
+			visibleObjects.resize(kept);
+		}
+		for (unsigned int type = 0; type < OBJECT_TYPE_COUNT; type++)
+			visibleByType[type].clear();
+		for (unsigned int i = 0; i < visibleObjects.size(); i++)
+			visibleByType[sceneObjects[visibleObjects[i]].type].push_back(visibleObjects[i]);
+
 		// ========== RENDERING CONTAINERS ==========
-		containerShader.useProgram();
-		//textures for containers
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, diffuseMap);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, specularMap);
-		//applying matrixes
-		containerShader.setVec3("u_viewPosition", camera.position);
-		containerShader.setMat4("u_projectionMatrix", projectionMatrix);
-		containerShader.setMat4("u_viewMatrix", cameraView);
-		//setting material properties
-		containerShader.setFloat("u_material.shininess", 32.0f);
-		//setting lighting
-		loadLighting(containerShader);
-
-		//drawing each cube
-		glBindVertexArray(VAO[0]);
-		for (unsigned int i = 0; i < 10; i++) {
-			glm::mat4 cubeModel = glm::mat4(1.0f);
-			cubeModel = glm::translate(cubeModel, cubePositions[i]);
-			cubeModel = glm::translate(cubeModel, glm::vec3(0.0f, 0.51f, 0.0f));
-			//enabling rotations
-			float angle = 20.0f + (i * 3);
-			cubeModel = glm::rotate(cubeModel, (float)glfwGetTime() * glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-			containerShader.setMat4("u_modelMatrix", cubeModel);
-			glDrawArrays(GL_TRIANGLES, 0, 36);
+		//drawing every visible cube in one instanced draw, lit by the lights reaching any of them
+		containerInstances.clear();
+		glm::vec3 containersMin(1e30f), containersMax(-1e30f);
+		for (unsigned int i = 0; i < visibleByType[OBJECT_CONTAINER].size(); i++) {
+			const glm::mat4& cubeModel = sceneObjects[visibleByType[OBJECT_CONTAINER][i]].modelMatrix;
+			containerInstances.add(cubeModel);
+			containersMin = glm::min(containersMin, glm::vec3(cubeModel[3]));
+			containersMax = glm::max(containersMax, glm::vec3(cubeModel[3]));
+		}
+
+		LightSelection containerLights = lightsForSphere(glm::mat4(1.0f), (containersMin + containersMax) * 0.5f, glm::length(containersMax - containersMin) * 0.5f + CUBE_RADIUS);
+		Shader& containerShader = phongShaders.get(containerCube.features | FEATURE_INSTANCED, containerLights.count);
+		if (containerInstances.size() > 0 && containerShader.isReady()) {
+			containerShader.useProgram();
+			ShaderLibrary::applyLightSelection(containerShader, containerLights);
+			GLState::bindVertexArray(containerCube.VAO);
+			unsigned int containerCount = containerInstances.upload();
+			containerInstances.bindAttributes(containerCube.VAO, 0, containerCube.positionScale, containerCube.positionOffset);
+			containerCube.DrawInstanced(containerShader, 0, containerCount);
 		}
 
 		// ========== RENDERING EMISSION CUBE ==========
-		lightingShader.useProgram();
-		//binding textures
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, diffuseMap);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, specularMap);
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, emissionMap);
-		//applying matrixes
-		lightingShader.setVec3("u_viewPosition", camera.position);
-		lightingShader.setMat4("u_projectionMatrix", projectionMatrix);
-		lightingShader.setMat4("u_viewMatrix", cameraView);
-		//setting material properties
-		lightingShader.setFloat("u_material.shininess", 32.0f);
-		//setting lighting
-		loadLighting(lightingShader);
-		//drawing emission cube
-		glBindVertexArray(VAO[0]);
-		glm::mat4 emissionCubeModel = glm::mat4(1.0f);
-		emissionCubeModel = glm::translate(emissionCubeModel, glm::vec3(5.0f, -3.0f, -3.0f));
-		//enabling rotations
-		float angle = 20.0f;
-		emissionCubeModel = glm::rotate(emissionCubeModel, (float)glfwGetTime() * glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-		containerShader.setMat4("u_modelMatrix", emissionCubeModel);
-		glDrawArrays(GL_TRIANGLES, 0, 36);
+		for (unsigned int i = 0; i < visibleByType[OBJECT_EMISSION_CUBE].size(); i++) {
+			const glm::mat4& emissionCubeModel = sceneObjects[visibleByType[OBJECT_EMISSION_CUBE][i]].modelMatrix;
+			LightSelection emissionLights = lightsForSphere(emissionCubeModel, glm::vec3(0.0f), CUBE_RADIUS);
+			Shader& lightingShader = phongShaders.get(emissionCube.features, emissionLights.count);
+			if (!lightingShader.isReady())
+				continue;
+			lightingShader.useProgram();
+			ShaderLibrary::applyLightSelection(lightingShader, emissionLights);
+			//drawing emission cube
+			lightingShader.setMat4("u_modelMatrix", emissionCubeModel);
+			emissionCube.Draw(lightingShader);
+		}
 
 
 		// ========== RENDERING BACKPACK MODEL ==========
-		stbi_set_flip_vertically_on_load(true);
-		backpackShader.useProgram();
-		backpackShader.setVec3("u_viewPosition", camera.position);
-		backpackShader.setMat4("u_projectionMatrix", projectionMatrix);
-		backpackShader.setMat4("u_viewMatrix", cameraView);
-		backpackShader.setFloat("u_material.shininess", 32.0f);
-		loadLighting(backpackShader);
-
-		glm::mat4 backpackModel = glm::mat4(1.0f);
-		backpackModel = glm::translate(backpackModel, glm::vec3(0.0f, 0.0f, -6.0f));
-		backpackModel = glm::scale(backpackModel, glm::vec3(0.5f));
-		backpackModel = glm::rotate(backpackModel, (float)glfwGetTime() * glm::radians(45.0f), glm::vec3(1.0f));
-		backpackShader.setMat4("u_modelMatrix", backpackModel);
-		backpack.Draw(backpackShader);
+		bool batched = submissionMode != SUBMIT_PER_OBJECT;
+		drawBatch.useIndirect = submissionMode != SUBMIT_MULTI_DRAW_FALLBACK;
+		loadingProxies.clear();
+
+		for (unsigned int i = 0; i < visibleByType[OBJECT_BACKPACK].size(); i++) {
+			const glm::mat4& backpackModel = sceneObjects[visibleByType[OBJECT_BACKPACK][i]].modelMatrix;
+			if (!backpack.ready()) {
+				loadingProxies.push_back(backpackModel);
+				continue;
+			}
+			LightSelection backpackLights = lightsForSphere(backpackModel, backpack.boundsCenter, backpack.boundsRadius);
+			if (batched)
+				backpack.Submit(drawBatch, phongShaders, backpackModel, backpackLights, drawView);
+			else
+				backpack.Draw(phongShaders, backpackModel, backpackLights, drawView);
+		}
 
 
 		// ========== RENDERING BLAHAJ MODEL ==========
-		blahajShader.useProgram();
-		blahajShader.setVec3("u_viewPosition", camera.position);
-		blahajShader.setMat4("u_projectionMatrix", projectionMatrix);
-		blahajShader.setMat4("u_viewMatrix", cameraView);
-		blahajShader.setFloat("u_material.shininess", 32.0f);
-		loadLighting(blahajShader);
-
-		for (unsigned int i = 0; i < 5; i++) {
-			float angle = 20.0f * i;
-			glm::mat4 blahajModel = glm::mat4(1.0f);
-			blahajModel = glm::translate(blahajModel, blahajPositions[i]);
-			blahajModel = glm::scale(blahajModel, glm::vec3(1.5f));
-			blahajModel = glm::rotate(blahajModel, (float)glfwGetTime() * glm::radians(angle), glm::vec3(1.0f, 2.5f, 0.5f));
-			blahajShader.setMat4("u_modelMatrix", blahajModel);
-			blahaj.Draw(blahajShader);
+		for (unsigned int i = 0; i < visibleByType[OBJECT_BLAHAJ].size(); i++) {
+			const glm::mat4& blahajModel = sceneObjects[visibleByType[OBJECT_BLAHAJ][i]].modelMatrix;
+			if (!blahaj.ready()) {
+				loadingProxies.push_back(blahajModel);
+				continue;
+			}
+			LightSelection blahajLights = lightsForSphere(blahajModel, blahaj.boundsCenter, blahaj.boundsRadius);
+			if (batched)
+				blahaj.Submit(drawBatch, phongShaders, blahajModel, blahajLights, drawView);
+			else
+				blahaj.Draw(phongShaders, blahajModel, blahajLights, drawView);
+		}
+
+		//benchmark field of blahajs in a grid below the scene, their matrices only worked out for the visible ones
+		//(it only shows up once the blahaj is loaded, a field of proxies would not measure anything)
+		benchmarkInstances.clear();
+		for (unsigned int i = 0; blahaj.ready() && i < visibleByType[OBJECT_BENCHMARK_BLAHAJ].size(); i++) {
+			const SceneObject& object = sceneObjects[visibleByType[OBJECT_BENCHMARK_BLAHAJ][i]];
+			glm::mat4 blahajModel = sceneObjectModel(object.type, object.index, currentFrame);
+			if (submissionMode == SUBMIT_INSTANCED) {
+				benchmarkInstances.add(blahajModel);
+				continue;
+			}
+
+			LightSelection blahajLights = lightsForSphere(blahajModel, blahaj.boundsCenter, blahaj.boundsRadius);
+			if (batched)
+				blahaj.Submit(drawBatch, phongShaders, blahajModel, blahajLights, drawView);
+			else
+				blahaj.Draw(phongShaders, blahajModel, blahajLights, drawView);
+		}
+		drawBatch.flush();
+
+		//the whole field shares the lights that reach the grid
+		if (benchmarkInstances.size() > 0) {
+			unsigned int rows = (sceneBenchmarkCount + BENCHMARK_ROW - 1) / BENCHMARK_ROW;
+			glm::vec3 fieldCenter(-1.0f, -8.0f, -(float)rows + 1.0f);
+			float fieldRadius = glm::length(glm::vec2((float)BENCHMARK_ROW, (float)rows)) + blahaj.boundsRadius;
+			blahaj.DrawInstanced(phongShaders, benchmarkInstances, lightsForSphere(glm::mat4(1.0f), fieldCenter, fieldRadius), drawView);
 		}
 
 
 		//======= CURRENTLY NOT USELESS SINCE WE ARE USING THE LIGHT POSITION RN =======		
-		//rendering light source
-		glBindVertexArray(VAO[0]);
-		lightCubeShader.useProgram();
-		lightCubeShader.setMat4("u_projectionMatrix", projectionMatrix);
-		lightCubeShader.setMat4("u_viewMatrix", cameraView);
-
-		for (int i = 0; i < 4; i++) {
-			glm::mat4 lightModel = glm::mat4(1.0f);
-			lightCubeShader.setVec3("u_lightColor", pointLightColors[i]);
-			lightModel = glm::translate(lightModel, pointLightPositions[i]);
-			lightModel = glm::scale(lightModel, glm::vec3(0.5f));
-			lightCubeShader.setMat4("u_modelMatrix", lightModel);
-			glDrawArrays(GL_TRIANGLES, 0, 36);
+		if (lightCubeShader.isReady()) {
+			//rendering light sources, the four point lights and then the direction light
+			lightCubeShader.useProgram();
+			for (unsigned int i = 0; i < visibleByType[OBJECT_LIGHT_CUBE].size(); i++) {
+				const SceneObject& object = sceneObjects[visibleByType[OBJECT_LIGHT_CUBE][i]];
+				lightCubeShader.setVec3("u_lightColor", object.index < 4 ? pointLightColors[object.index] : glm::vec3(1.0f));
+				lightCubeShader.setMat4("u_modelMatrix", object.modelMatrix);
+				lightCube.Draw(lightCubeShader);
+			}
+
+			//flat cubes where models are still loading
+			lightCubeShader.setVec3("u_lightColor", LOADING_PROXY_COLOR);
+			for (unsigned int i = 0; i < loadingProxies.size(); i++) {
+				lightCubeShader.setMat4("u_modelMatrix", loadingProxies[i]);
+				lightCube.Draw(lightCubeShader);
+			}
 		}
 
-		//rendering direction light source
-		glBindVertexArray(VAO[0]);
-		lightCubeShader.useProgram();
-		lightCubeShader.setMat4("u_projectionMatrix", projectionMatrix);
-		lightCubeShader.setMat4("u_viewMatrix", cameraView);
-		glm::mat4 dirLightModel = glm::mat4(1.0f);
-		lightCubeShader.setVec3("u_lightColor", glm::vec3(1.0f));
-		dirLightModel = glm::translate(dirLightModel, lightDirection);
-		lightCubeShader.setMat4("u_modelMatrix", dirLightModel);
-		glDrawArrays(GL_TRIANGLES, 0, 36);
-
 
 		//checking call events and swapping buffers
+		StreamBuffer::get().endFrame();
+		FrameStats::get().endFrame();
 		glfwSwapBuffers(window);
+
+		//with the models loading in the background this no longer depends on how big they are
+		if (!firstFrameReported) {
+			double firstFrameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupStart).count();
+			std::cout << "STARTUP: first frame presented after " << firstFrameMs << " ms" << std::endl;
+			firstFrameReported = true;
+		}
 		glfwPollEvents();
 	}
 
-	//optional: deleting the vertex arrays
-	glDeleteVertexArrays(2, VAO);
-	glDeleteBuffers(2, VBO);
-	glDeleteBuffers(1, &EBO);
+	GLState::invalidate();
 	glfwTerminate();		//clearing resources that were allocated
 	return 0;
 }
@@ -394,10 +552,21 @@ void processInput(GLFWwindow* window) {
 	bool enterPressed = glfwGetKey(window, GLFW_KEY_ENTER) == GLFW_PRESS;
 
 	//variables for toggling between free fly / FPS mode
-	static bool s_fpsMode = false;
 	static bool s_eState = false;
 	bool ePressed = glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS;
 
+	//variables for toggling the frame stats and the benchmark switches
+	static bool s_pState = false;
+	bool pPressed = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+	static bool s_lState = false;
+	bool lPressed = glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS;
+	static bool s_bState = false;
+	bool bPressed = glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS;
+	static bool s_mState = false;
+	bool mPressed = glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS;
+	static bool s_oState = false;
+	bool oPressed = glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS;
+
 	//if the user presses escape, close the window
 	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 		glfwSetWindowShouldClose(window, true);
@@ -412,10 +581,10 @@ void processInput(GLFWwindow* window) {
 
 	//if the user presses E, toggle between free fly / FPS camera
 	if (ePressed && !s_eState) {
-		s_fpsMode = !s_fpsMode;
-		if (s_fpsMode) {
+		fpsMode = !fpsMode;
+		if (fpsMode) {
 			std::cout << "FPS MODE ENABLED!" << std::endl;
-			camera.position.y = 1.0f;
+			camera.fallSpeed = 0.0f;
 		} 
 		else {
 			std::cout << "FREE FLY MODE ENABLED!" << std::endl;
@@ -423,7 +592,43 @@ void processInput(GLFWwindow* window) {
 	}
 	s_eState = ePressed;
 
-	if (s_fpsMode) {
+	//if the user presses P, toggle printing the frame stats
+	if (pPressed && !s_pState) {
+		FrameStats::get().enabled = !FrameStats::get().enabled;
+		std::cout << "FRAME STATS " << (FrameStats::get().enabled ? "ENABLED!" : "DISABLED!") << std::endl;
+	}
+	s_pState = pPressed;
+
+	//if the user presses L, toggle between the reflected uniform table and calling glGetUniformLocation every time
+	if (lPressed && !s_lState) {
+		Shader::legacyUniformLookup() = !Shader::legacyUniformLookup();
+		std::cout << "UNIFORM LOOKUP: " << (Shader::legacyUniformLookup() ? "glGetUniformLocation PER CALL" : "REFLECTED TABLE") << std::endl;
+	}
+	s_lState = lPressed;
+
+	//if the user presses B, cycle how many benchmark blahajs get drawn
+	if (bPressed && !s_bState) {
+		benchmarkLevel = (benchmarkLevel + 1) % (sizeof(BENCHMARK_COUNTS) / sizeof(BENCHMARK_COUNTS[0]));
+		std::cout << "BENCHMARK OBJECTS: " << BENCHMARK_COUNTS[benchmarkLevel] << std::endl;
+	}
+	s_bState = bPressed;
+
+	//if the user presses M, cycle between per object draws, the two batched submission paths and instancing
+	if (mPressed && !s_mState) {
+		submissionMode = (submission_mode)((submissionMode + 1) % 4);
+		const char* names[] = { "PER OBJECT DRAWS", "MULTI DRAW INDIRECT", "MULTI DRAW BASE VERTEX (GL 3.3 FALLBACK)", "INSTANCED BENCHMARK FIELD" };
+		std::cout << "DRAW SUBMISSION: " << names[submissionMode] << std::endl;
+	}
+	s_mState = mPressed;
+
+	//if the user presses O, toggle the software occlusion culling
+	if (oPressed && !s_oState) {
+		occlusionCulling = !occlusionCulling;
+		std::cout << "OCCLUSION CULLING " << (occlusionCulling ? "ENABLED!" : "DISABLED!") << std::endl;
+	}
+	s_oState = oPressed;
+
+	if (fpsMode) {
 		//camera movement inputs - FPS VERSION
 		if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
 			camera.processFPSMovement(FORWARD, deltaTime);
@@ -487,7 +692,7 @@ unsigned int loadTexture(char const* path) {
 			textureFormat = GL_RGBA;
 
 		//binding the texture
-		glBindTexture(GL_TEXTURE_2D, textureID);
+		GLState::bindTexture(0, textureID);
 		glTexImage2D(GL_TEXTURE_2D, 0, textureFormat, width, height, 0,	textureFormat, GL_UNSIGNED_BYTE, data);
 		glGenerateMipmap(GL_TEXTURE_2D);
 		//texture wrapping + mipmapping
@@ -506,40 +711,168 @@ unsigned int loadTexture(char const* path) {
 	return textureID;
 }
 
-//function that will apply the lighting uniforms to the respective shaders
-void loadLighting(Shader &shader) {
+//function that fills the cpu copy of the shared Lights block
+void updateLights(LightsBlock &lights) {
 	//DIRECTIONAL LIGHTING
-	shader.setVec3("u_dirLight.direction", lightDirection);
-	shader.setVec3("u_dirLight.ambient", dirLightAmbient);
-	shader.setVec3("u_dirLight.diffuse", dirLightDiffuse);
-	shader.setVec3("u_dirLight.specular", dirLightSpecular);
+	lights.dirLight.direction = lightDirection;
+	lights.dirLight.ambient = dirLightAmbient;
+	lights.dirLight.diffuse = dirLightDiffuse;
+	lights.dirLight.specular = dirLightSpecular;
 
 	//POINT LIGHTING (based on definition per shader)
-	for (unsigned int i = 0; i < 4; i++) {
-		//converting i to a string to utilise within uniform setting
-		std::string index = std::to_string(i);
-
-		shader.setVec3("u_pointLight[" + index + "].position", pointLightPositions[i]);
-		shader.setVec3("u_pointLight[" + index + "].ambient", pointLightColors[i] * 0.1f);
-		shader.setVec3("u_pointLight[" + index + "].diffuse", pointLightColors[i]);
-		shader.setVec3("u_pointLight[" + index + "].specular", pointLightColors[i]);
-
-		shader.setFloat("u_pointLight[" + index + "].constant", 1.0f);
-		shader.setFloat("u_pointLight[" + index + "].linear", 0.09f);
-		shader.setFloat("u_pointLight[" + index + "].quadratic", 0.032f);
+	for (unsigned int i = 0; i < MAX_POINT_LIGHTS; i++) {
+		PointLightData& pointLight = lights.pointLights[i];
+		pointLight.position = pointLightPositions[i];
+		pointLight.ambient = pointLightColors[i] * 0.1f;
+		pointLight.diffuse = pointLightColors[i];
+		pointLight.specular = pointLightColors[i];
+
+		pointLight.constant = 1.0f;
+		pointLight.linear = 0.09f;
+		pointLight.quadratic = 0.032f;
 	}
 
 	//SPOT LIGHTING
-	shader.setVec3("u_spotLight.position", camera.position);
-	shader.setVec3("u_spotLight.direction", camera.front);
-	shader.setVec3("u_spotLight.ambient", 0.0f, 0.0f, 0.0f);
-	shader.setVec3("u_spotLight.diffuse", 1.0f, 1.0f, 1.0f);
-	shader.setVec3("u_spotLight.specular", 1.0f, 1.0f, 1.0f);
-
-	shader.setFloat("u_spotLight.constant", 1.0f);
-	shader.setFloat("u_spotLight.linear", 0.22f);
-	shader.setFloat("u_spotLight.quadratic", 0.20f);
-
-	shader.setFloat("u_spotLight.cutOff", glm::cos(glm::radians(10.0f)));
-	shader.setFloat("u_spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
-}
\ No newline at end of file
+	lights.spotLight.position = camera.position;
+	lights.spotLight.direction = camera.front;
+	lights.spotLight.ambient = glm::vec3(0.0f, 0.0f, 0.0f);
+	lights.spotLight.diffuse = glm::vec3(1.0f, 1.0f, 1.0f);
+	lights.spotLight.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+
+	lights.spotLight.constant = 1.0f;
+	lights.spotLight.linear = 0.22f;
+	lights.spotLight.quadratic = 0.20f;
+
+	lights.spotLight.cutOff = glm::cos(glm::radians(10.0f));
+	lights.spotLight.outerCutOff = glm::cos(glm::radians(15.0f));
+}
+
+//function that picks the point lights reaching a model space bounding sphere placed with a model matrix
+LightSelection lightsForSphere(const glm::mat4 &modelMatrix, const glm::vec3 &center, float radius) {
+	glm::vec3 worldCenter = glm::vec3(modelMatrix * glm::vec4(center, 1.0f));
+	float maxScale = glm::max(glm::max(glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1]))), glm::length(glm::vec3(modelMatrix[2])));
+	return ShaderLibrary::selectPointLights(sceneLights, worldCenter, radius * maxScale);
+}
+
+//function that places a scene object at the given time, every cube and blahaj spinning around its own axis
+glm::mat4 sceneObjectModel(scene_object_type type, unsigned int index, float time) {
+	glm::mat4 model = glm::mat4(1.0f);
+	switch (type) {
+	case OBJECT_CONTAINER:
+		model = glm::translate(model, cubePositions[index]);
+		model = glm::translate(model, glm::vec3(0.0f, 0.51f, 0.0f));
+		model = glm::rotate(model, time * glm::radians(20.0f + (index * 3)), glm::vec3(1.0f, 0.3f, 0.5f));
+		break;
+	case OBJECT_EMISSION_CUBE:
+		model = glm::translate(model, glm::vec3(5.0f, -3.0f, -3.0f));
+		model = glm::rotate(model, time * glm::radians(20.0f), glm::vec3(1.0f, 0.3f, 0.5f));
+		break;
+	case OBJECT_BACKPACK:
+		model = glm::translate(model, glm::vec3(0.0f, 0.0f, -6.0f));
+		model = glm::scale(model, glm::vec3(0.5f));
+		model = glm::rotate(model, time * glm::radians(45.0f), glm::vec3(1.0f));
+		break;
+	case OBJECT_BLAHAJ:
+		model = glm::translate(model, blahajPositions[index]);
+		model = glm::scale(model, glm::vec3(1.5f));
+		model = glm::rotate(model, time * glm::radians(20.0f * index), glm::vec3(1.0f, 2.5f, 0.5f));
+		break;
+	case OBJECT_LIGHT_CUBE:
+		//the four point lights and then the direction light
+		if (index < 4) {
+			model = glm::translate(model, pointLightPositions[index]);
+			model = glm::scale(model, glm::vec3(0.5f));
+		}
+		else {
+			model = glm::translate(model, lightDirection);
+		}
+		break;
+	case OBJECT_BENCHMARK_BLAHAJ:
+		model = glm::translate(model, glm::vec3((float)(index % BENCHMARK_ROW) * 2.0f - BENCHMARK_ROW, -8.0f, -(float)(index / BENCHMARK_ROW) * 2.0f));
+		model = glm::rotate(model, time + index, glm::vec3(0.0f, 1.0f, 0.0f));
+		break;
+	default:
+		break;
+	}
+	return model;
+}
+
+//function that pushes the FPS camera's body out of the scene's geometry and then stands it on the highest surface
+//below it. objects are found through the scene tree and their triangles queried in their own model space
+void collideCamera(CameraCollision& collision, SceneBVH& sceneTree, const std::vector<SceneObject>& sceneObjects, const std::vector<const TriangleBVH*> objectCollision[], float time) {
+	std::vector<unsigned int>& nearby = collision.nearby;
+	std::vector<TriangleBVH::SphereContact>& contacts = collision.contacts;
+
+	//walls: resolving the deepest contact of the waist sphere at a time, a few rounds being enough for corners
+	for (int iteration = 0; iteration < 4; iteration++) {
+		glm::vec3 waist = camera.position - glm::vec3(0.0f, camera.eyeHeight * 0.5f, 0.0f);
+		nearby.clear();
+		sceneTree.querySphere(waist, camera.bodyRadius, nearby);
+
+		glm::vec3 push(0.0f);
+		float deepest = 0.0f;
+		for (unsigned int i = 0; i < nearby.size(); i++) {
+			const SceneObject& object = sceneObjects[nearby[i]];
+			//the benchmark blahajs only get their matrices worked out when drawn
+			glm::mat4 model = object.type == OBJECT_BENCHMARK_BLAHAJ ? sceneObjectModel(object.type, object.index, time) : object.modelMatrix;
+			float scale = glm::length(glm::vec3(model[0]));		//every object is scaled uniformly
+			glm::vec3 localWaist = glm::vec3(glm::inverse(model) * glm::vec4(waist, 1.0f));
+
+			contacts.clear();
+			const std::vector<const TriangleBVH*>& trees = objectCollision[object.type];
+			for (unsigned int t = 0; t < trees.size(); t++)
+				trees[t]->querySphere(localWaist, camera.bodyRadius / scale, contacts);
+
+			for (unsigned int c = 0; c < contacts.size(); c++) {
+				glm::vec3 point = glm::vec3(model * glm::vec4(contacts[c].point, 1.0f));
+				float depth = camera.bodyRadius - glm::length(waist - point);
+				//only pushing sideways, whatever is right below or above is up to the ground check
+				glm::vec3 away = waist - point;
+				away.y = 0.0f;
+				if (depth > deepest && glm::length(away) > 1e-4f) {
+					deepest = depth;
+					push = glm::normalize(away) * depth;
+				}
+			}
+		}
+		if (deepest <= 0.0f)
+			break;
+		camera.position += push;
+	}
+
+	//ground: the closest surface straight below the waist, anything lower than the floor does not matter
+	glm::vec3 waist = camera.position - glm::vec3(0.0f, camera.eyeHeight * 0.5f, 0.0f);
+	float ground = FLOOR_HEIGHT;
+	nearby.clear();
+	if (waist.y > FLOOR_HEIGHT)
+		sceneTree.queryRay(waist, glm::vec3(0.0f, -1.0f, 0.0f), waist.y - FLOOR_HEIGHT, nearby);
+	for (unsigned int i = 0; i < nearby.size(); i++) {
+		const SceneObject& object = sceneObjects[nearby[i]];
+		glm::mat4 model = object.type == OBJECT_BENCHMARK_BLAHAJ ? sceneObjectModel(object.type, object.index, time) : object.modelMatrix;
+		glm::mat4 inverse = glm::inverse(model);
+		//the model space ray keeps the world's distances since its direction is transformed along
+		glm::vec3 localWaist = glm::vec3(inverse * glm::vec4(waist, 1.0f));
+		glm::vec3 localDown = glm::mat3(inverse) * glm::vec3(0.0f, -1.0f, 0.0f);
+
+		const std::vector<const TriangleBVH*>& trees = objectCollision[object.type];
+		for (unsigned int t = 0; t < trees.size(); t++) {
+			TriangleBVH::RayHit hit;
+			if (trees[t]->raycast(localWaist, localDown, waist.y - ground, hit))
+				ground = waist.y - hit.distance;
+		}
+	}
+
+	//stepping up onto anything below the waist right away, falling down onto it
+	float feet = camera.position.y - camera.eyeHeight;
+	if (feet <= ground) {
+		feet = ground;
+		camera.fallSpeed = 0.0f;
+	}
+	else {
+		camera.fallSpeed += GRAVITY * deltaTime;
+		feet = glm::max(feet - camera.fallSpeed * deltaTime, ground);
+		if (feet == ground)
+			camera.fallSpeed = 0.0f;
+	}
+	camera.position.y = feet + camera.eyeHeight;
+}
@@ -6,6 +6,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "Frustum.h"
+
 //defining the different options for camera movement
 enum camera_movement {
 	FORWARD, BACKWARD, LEFT, RIGHT
@@ -39,6 +41,11 @@ public:
 	float mouseSensitivity;
 	float zoom;				//fov
 
+	//FPS body: the eye sits eyeHeight above the feet and walls keep bodyRadius away from the waist
+	float eyeHeight = 1.0f;
+	float bodyRadius = 0.3f;
+	float fallSpeed = 0.0f;
+
 	//constructor with vectors
 	Camera
 	(
@@ -76,6 +83,12 @@ public:
 		return glm::lookAt(position, position + front, up);
 	}
 
+	//world space planes of what the camera sees through the given projection
+	Frustum GetFrustum(const glm::mat4& projection)
+	{
+		return Frustum::fromMatrix(projection * GetViewMatrix());
+	}
+
 	//FREE FLY movement
 	void processMovement(camera_movement direction, float deltaTime)
 	{
@@ -94,22 +107,20 @@ public:
 
 	}
 
-	//FPS movement
+	//FPS movement, walking along the ground (the height is up to the collision with the scene)
 	void processFPSMovement(camera_movement direction, float deltaTime)
 	{
 		float velocity = movementSpeed * deltaTime;
+		glm::vec3 forward = glm::normalize(glm::vec3(front.x, 0.0f, front.z));
 		if (direction == FORWARD)
-			position += front * velocity;
+			position += forward * velocity;
 		if (direction == BACKWARD)
-			position -= front * velocity;
+			position -= forward * velocity;
 		if (direction == LEFT)
 			position -= right * velocity;
 		if (direction == RIGHT)
 			position += right * velocity;
 
-		//locking to user to stay grounded
-		position.y = 1.0f;
-
 		//logging XYZ coordinates
 		std::cout << "X: " << position.x << " | Y: " << position.y << " | Z: " << position.z << std::endl;
 	}
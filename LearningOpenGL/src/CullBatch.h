@@ -0,0 +1,156 @@
+#pragma once
+#ifndef CULL_BATCH_H
+#define CULL_BATCH_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CULL_BATCH_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#define CULL_BATCH_SSE
+#endif
+
+#include "Frustum.h"
+#include "FrameStats.h"
+
+//world space bounds of many draws, tested against a frustum together. the bounds are kept as structure of arrays so
+//the kernel tests 8 (AVX) or 4 (SSE) of them per plane at once. every entry is a box and a sphere around the same
+//center, and it gets culled as soon as either of them is fully behind a plane
+class CullBatch {
+public:
+	void clear()
+	{
+		m_count = 0;
+	}
+
+	size_t size() const { return m_count; }
+
+	//transforming model space bounds (box center + half extents, and the radius around that center) into world space
+	unsigned int add(const glm::mat4& modelMatrix, const glm::vec3& center, const glm::vec3& extents, float radius)
+	{
+		glm::vec3 worldCenter = glm::vec3(modelMatrix * glm::vec4(center, 1.0f));
+		glm::mat3 absolute = glm::mat3(glm::abs(glm::vec3(modelMatrix[0])), glm::abs(glm::vec3(modelMatrix[1])), glm::abs(glm::vec3(modelMatrix[2])));
+		glm::vec3 worldExtents = absolute * extents;
+		float scale = glm::max(glm::max(glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1]))), glm::length(glm::vec3(modelMatrix[2])));
+		return addWorld(worldCenter, worldExtents, radius * scale);
+	}
+
+	unsigned int addWorld(const glm::vec3& center, const glm::vec3& extents, float radius)
+	{
+		if (m_count == m_centerX.size())
+			m_Grow();
+		unsigned int index = (unsigned int)m_count++;
+		m_centerX[index] = center.x;
+		m_centerY[index] = center.y;
+		m_centerZ[index] = center.z;
+		m_extentX[index] = extents.x;
+		m_extentY[index] = extents.y;
+		m_extentZ[index] = extents.z;
+		m_radius[index] = radius;
+		return index;
+	}
+
+	//testing every entry, visible(i) holds the result until the next cull
+	void cull(const Frustum& frustum)
+	{
+		m_visible.resize(m_centerX.size());
+		size_t i = 0;
+#if defined(CULL_BATCH_AVX)
+		for (; i + 8 <= m_count; i += 8)
+			m_Cull8(frustum, i);
+#elif defined(CULL_BATCH_SSE)
+		for (; i + 4 <= m_count; i += 4)
+			m_Cull4(frustum, i);
+#endif
+		for (; i < m_count; i++)
+			m_visible[i] = m_CullOne(frustum, i);
+
+		unsigned int culled = 0;
+		for (i = 0; i < m_count; i++)
+			culled += m_visible[i] ? 0 : 1;
+		FrameStats::get().frame.boundsTested += m_count;
+		FrameStats::get().frame.boundsCulled += culled;
+	}
+
+	bool visible(unsigned int index) const { return m_visible[index] != 0; }
+
+private:
+	size_t m_count = 0;
+	std::vector<float> m_centerX, m_centerY, m_centerZ;
+	std::vector<float> m_extentX, m_extentY, m_extentZ;
+	std::vector<float> m_radius;
+	std::vector<unsigned char> m_visible;
+
+	//growing in steps of 8 so the wide loads never run past the arrays
+	void m_Grow()
+	{
+		size_t capacity = m_centerX.size() < 64 ? 64 : m_centerX.size() * 2;
+		m_centerX.resize(capacity);
+		m_centerY.resize(capacity);
+		m_centerZ.resize(capacity);
+		m_extentX.resize(capacity);
+		m_extentY.resize(capacity);
+		m_extentZ.resize(capacity);
+		m_radius.resize(capacity);
+	}
+
+	unsigned char m_CullOne(const Frustum& frustum, size_t i) const
+	{
+		for (int p = 0; p < 6; p++) {
+			const glm::vec4& plane = frustum.planes[p];
+			float distance = plane.x * m_centerX[i] + plane.y * m_centerY[i] + plane.z * m_centerZ[i] + plane.w;
+			float boxReach = glm::abs(plane.x) * m_extentX[i] + glm::abs(plane.y) * m_extentY[i] + glm::abs(plane.z) * m_extentZ[i];
+			if (distance < -glm::min(boxReach, m_radius[i]))
+				return 0;
+		}
+		return 1;
+	}
+
+#if defined(CULL_BATCH_AVX)
+	void m_Cull8(const Frustum& frustum, size_t i)
+	{
+		__m256 cx = _mm256_loadu_ps(&m_centerX[i]), cy = _mm256_loadu_ps(&m_centerY[i]), cz = _mm256_loadu_ps(&m_centerZ[i]);
+		__m256 ex = _mm256_loadu_ps(&m_extentX[i]), ey = _mm256_loadu_ps(&m_extentY[i]), ez = _mm256_loadu_ps(&m_extentZ[i]);
+		__m256 radius = _mm256_loadu_ps(&m_radius[i]);
+		__m256 outside = _mm256_setzero_ps();
+		for (int p = 0; p < 6; p++) {
+			const glm::vec4& plane = frustum.planes[p];
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.x), cx), _mm256_mul_ps(_mm256_set1_ps(plane.y), cy)),
+				_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane.z), cz), _mm256_set1_ps(plane.w)));
+			__m256 boxReach = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(glm::abs(plane.x)), ex), _mm256_mul_ps(_mm256_set1_ps(glm::abs(plane.y)), ey)),
+				_mm256_mul_ps(_mm256_set1_ps(glm::abs(plane.z)), ez));
+			__m256 reach = _mm256_min_ps(boxReach, radius);
+			outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), _mm256_setzero_ps(), _CMP_LT_OQ));
+		}
+		int mask = _mm256_movemask_ps(outside);
+		for (int k = 0; k < 8; k++)
+			m_visible[i + k] = (mask >> k) & 1 ? 0 : 1;
+	}
+#elif defined(CULL_BATCH_SSE)
+	void m_Cull4(const Frustum& frustum, size_t i)
+	{
+		__m128 cx = _mm_loadu_ps(&m_centerX[i]), cy = _mm_loadu_ps(&m_centerY[i]), cz = _mm_loadu_ps(&m_centerZ[i]);
+		__m128 ex = _mm_loadu_ps(&m_extentX[i]), ey = _mm_loadu_ps(&m_extentY[i]), ez = _mm_loadu_ps(&m_extentZ[i]);
+		__m128 radius = _mm_loadu_ps(&m_radius[i]);
+		__m128 outside = _mm_setzero_ps();
+		for (int p = 0; p < 6; p++) {
+			const glm::vec4& plane = frustum.planes[p];
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cx), _mm_mul_ps(_mm_set1_ps(plane.y), cy)),
+				_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), cz), _mm_set1_ps(plane.w)));
+			__m128 boxReach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(glm::abs(plane.x)), ex), _mm_mul_ps(_mm_set1_ps(glm::abs(plane.y)), ey)),
+				_mm_mul_ps(_mm_set1_ps(glm::abs(plane.z)), ez));
+			__m128 reach = _mm_min_ps(boxReach, radius);
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+		}
+		int mask = _mm_movemask_ps(outside);
+		for (int k = 0; k < 4; k++)
+			m_visible[i + k] = (mask >> k) & 1 ? 0 : 1;
+	}
+#endif
+};
+
+#endif
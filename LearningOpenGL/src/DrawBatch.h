@@ -0,0 +1,207 @@
+#pragma once
+#ifndef DRAW_BATCH_H
+#define DRAW_BATCH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include "Shader.h"
+#include "GLState.h"
+#include "FrameStats.h"
+#include "Material.h"
+#include "ShaderLibrary.h"
+#include "VertexFormat.h"
+#include "StreamBuffer.h"
+
+//per draw data the INSTANCED vertex permutation reads as attributes 3 - 11
+struct DrawInstance {
+	InstanceTransform transform;
+	glm::vec4 positionScale;		//dequantization of packed meshes (scale 1, offset 0 for float ones)
+	glm::vec4 positionOffset;
+};
+
+//record layout glMultiDrawElementsIndirect reads from the indirect buffer
+struct DrawElementsIndirectCommand {
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+//collects a frame's draws, sorts them by state and submits every run that shares a program, material, VAO and
+//light selection together. with GL 4.3 a run is one glMultiDrawElementsIndirect where each command's baseInstance
+//picks its instance data, on GL 3.3 it is one glMultiDrawElementsBaseVertex per instance in the run
+class DrawBatch {
+public:
+	bool useIndirect = true;		//lets the benchmark force the GL 3.3 path
+
+	static bool indirectSupported()
+	{
+		return GLAD_GL_VERSION_4_3 && glMultiDrawElementsIndirect != NULL;
+	}
+
+	//returns the index draws refer to their instance data with
+	unsigned int addInstance(const glm::mat4& modelMatrix, const glm::vec3& positionScale, const glm::vec3& positionOffset)
+	{
+		DrawInstance instance;
+		instance.transform = InstanceTransform(modelMatrix);
+		instance.positionScale = glm::vec4(positionScale, 0.0f);
+		instance.positionOffset = glm::vec4(positionOffset, 0.0f);
+		m_instances.push_back(instance);
+		return (unsigned int)m_instances.size() - 1;
+	}
+
+	//firstIndex is counted from the start of the VAO's element buffer
+	void addDraw(Shader& shader, Material& material, const LightSelection& lights, unsigned int VAO, GLenum indexType,
+		unsigned int firstIndex, unsigned int count, int baseVertex, unsigned int instance)
+	{
+		Draw draw;
+		draw.shader = &shader;
+		draw.material = &material;
+		draw.lights = lights;
+		draw.VAO = VAO;
+		draw.indexType = indexType;
+		draw.command.count = count;
+		draw.command.instanceCount = 1;
+		draw.command.firstIndex = firstIndex;
+		draw.command.baseVertex = baseVertex;
+		draw.command.baseInstance = instance;
+		m_draws.push_back(draw);
+	}
+
+	size_t drawCount() const { return m_draws.size(); }
+
+	//submitting everything that was added this frame
+	void flush()
+	{
+		if (m_draws.empty()) {
+			m_instances.clear();
+			return;
+		}
+
+		std::sort(m_draws.begin(), m_draws.end(), m_DrawOrder);
+		bool indirect = useIndirect && indirectSupported();
+
+		//instances and commands go into this frame's stream region
+		StreamBuffer& stream = StreamBuffer::get();
+		m_instanceData = stream.write(&m_instances[0], m_instances.size() * sizeof(DrawInstance));
+		StreamBuffer::Allocation commandData;
+		if (indirect) {
+			m_commands.clear();
+			for (unsigned int i = 0; i < m_draws.size(); i++)
+				m_commands.push_back(m_draws[i].command);
+			commandData = stream.write(&m_commands[0], m_commands.size() * sizeof(DrawElementsIndirectCommand));
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandData.bufferID);
+		}
+
+		FrameStats::Counters& stats = FrameStats::get().frame;
+		unsigned int start = 0;
+		while (start < m_draws.size()) {
+			unsigned int end = start + 1;
+			while (end < m_draws.size() && m_SameState(m_draws[start], m_draws[end]))
+				end++;
+
+			//state of the run
+			const Draw& first = m_draws[start];
+			first.shader->useProgram();
+			first.material->bind(*first.shader);
+			ShaderLibrary::applyLightSelection(*first.shader, first.lights);
+			GLState::bindVertexArray(first.VAO);
+
+			for (unsigned int i = start; i < end; i++)
+				stats.trianglesDrawn += m_draws[i].command.count / 3;
+
+			if (indirect) {
+				m_PointInstanceAttributes(first.VAO, 0);
+				glMultiDrawElementsIndirect(GL_TRIANGLES, first.indexType, (const void*)(commandData.offset + start * sizeof(DrawElementsIndirectCommand)), end - start, 0);
+				stats.drawCalls++;
+			}
+			else {
+				m_SubmitFallback(start, end);
+			}
+			start = end;
+		}
+
+		m_draws.clear();
+		m_instances.clear();
+	}
+
+private:
+	struct Draw {
+		Shader* shader;
+		Material* material;
+		LightSelection lights;
+		unsigned int VAO;
+		GLenum indexType;
+		DrawElementsIndirectCommand command;
+	};
+
+	StreamBuffer::Allocation m_instanceData;		//where this frame's instances went
+	std::vector<DrawInstance> m_instances;
+	std::vector<Draw> m_draws;
+
+	//scratch arrays reused between frames
+	std::vector<DrawElementsIndirectCommand> m_commands;
+	std::vector<GLsizei> m_counts;
+	std::vector<const void*> m_offsets;
+	std::vector<GLint> m_baseVertices;
+
+	static bool m_DrawOrder(const Draw& a, const Draw& b)
+	{
+		if (a.shader->programID != b.shader->programID)
+			return a.shader->programID < b.shader->programID;
+		if (a.material != b.material)
+			return a.material < b.material;
+		if (a.VAO != b.VAO)
+			return a.VAO < b.VAO;
+		if (a.indexType != b.indexType)
+			return a.indexType < b.indexType;
+		if (a.lights.count != b.lights.count)
+			return a.lights.count < b.lights.count;
+		for (int i = 0; i < 4; i++) {
+			if (a.lights.indices[i] != b.lights.indices[i])
+				return a.lights.indices[i] < b.lights.indices[i];
+		}
+		return a.command.baseInstance < b.command.baseInstance;
+	}
+
+	static bool m_SameState(const Draw& a, const Draw& b)
+	{
+		return a.shader == b.shader && a.material == b.material && a.VAO == b.VAO && a.indexType == b.indexType
+			&& a.lights.count == b.lights.count && a.lights.indices == b.lights.indices;
+	}
+
+	//without baseInstance the attributes get pointed at each instance in turn
+	void m_SubmitFallback(unsigned int start, unsigned int end)
+	{
+		unsigned int indexSize = m_draws[start].indexType == GL_UNSIGNED_SHORT ? 2 : 4;
+		unsigned int i = start;
+		while (i < end) {
+			unsigned int instance = m_draws[i].command.baseInstance;
+			m_counts.clear();
+			m_offsets.clear();
+			m_baseVertices.clear();
+			for (; i < end && m_draws[i].command.baseInstance == instance; i++) {
+				m_counts.push_back(m_draws[i].command.count);
+				m_offsets.push_back((const void*)((size_t)m_draws[i].command.firstIndex * indexSize));
+				m_baseVertices.push_back(m_draws[i].command.baseVertex);
+			}
+
+			m_PointInstanceAttributes(m_draws[start].VAO, instance);
+			glMultiDrawElementsBaseVertex(GL_TRIANGLES, &m_counts[0], m_draws[start].indexType, &m_offsets[0], (GLsizei)m_counts.size(), &m_baseVertices[0]);
+			FrameStats::get().frame.drawCalls++;
+		}
+	}
+
+	//pointing the bound VAO's instance attributes at one instance
+	void m_PointInstanceAttributes(unsigned int VAO, unsigned int instance)
+	{
+		InstanceAttributes::point(VAO, m_instanceData.bufferID, m_instanceData.offset + (size_t)instance * sizeof(DrawInstance), sizeof(DrawInstance), offsetof(DrawInstance, positionScale));
+	}
+};
+
+#endif
@@ -0,0 +1,128 @@
+#pragma once
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#include <chrono>
+#include <iostream>
+
+//per frame counters used to benchmark the renderer (toggled with P, printed as averages every few seconds)
+class FrameStats {
+public:
+	//counters that get reset at the start of every frame
+	struct Counters {
+		unsigned long long uniformCalls = 0;		//glUniform* calls issued
+		unsigned long long locationQueries = 0;		//glGetUniformLocation calls issued
+		unsigned long long uniformCallsSkipped = 0;	//glUniform* calls the shadow store found unchanged
+		unsigned long long uniformBytesSkipped = 0;	//bytes of uniform data those calls would have sent
+		unsigned long long stateCallsIssued = 0;	//binds that reached the driver through GLState
+		unsigned long long stateCallsSkipped = 0;	//binds GLState dropped because nothing would change
+		unsigned long long vertexBytes = 0;			//size of the vertex buffers of every mesh drawn
+		unsigned long long trianglesDrawn = 0;		//triangles submitted by mesh draws (after LOD selection)
+		unsigned long long meshletsDrawn = 0;		//meshlets that passed the frustum and cone tests
+		unsigned long long meshletsCulled = 0;
+		unsigned long long drawCalls = 0;			//glDraw* calls issued (a multi-draw counts as one)
+		unsigned long long instancesDrawn = 0;		//copies drawn by instanced model draws
+		unsigned long long instancesCulled = 0;		//copies whose bounding sphere was outside the frustum
+		unsigned long long boundsTested = 0;		//bounding volumes run through the frustum culling kernel
+		unsigned long long boundsCulled = 0;
+		unsigned long long bvhNodesVisited = 0;		//scene tree nodes a frustum query went through
+		unsigned long long occluderTriangles = 0;	//triangles rasterized into the software occlusion buffer
+		unsigned long long occlusionTested = 0;		//bounding boxes tested against the occlusion buffer
+		unsigned long long occlusionCulled = 0;
+		unsigned long long streamedBytes = 0;		//per frame data written to the stream buffer
+		unsigned long long streamWaits = 0;			//frames that had to wait for the GPU to free their stream region
+
+		void add(const Counters& other)
+		{
+			uniformCalls += other.uniformCalls;
+			locationQueries += other.locationQueries;
+			uniformCallsSkipped += other.uniformCallsSkipped;
+			uniformBytesSkipped += other.uniformBytesSkipped;
+			stateCallsIssued += other.stateCallsIssued;
+			stateCallsSkipped += other.stateCallsSkipped;
+			vertexBytes += other.vertexBytes;
+			trianglesDrawn += other.trianglesDrawn;
+			meshletsDrawn += other.meshletsDrawn;
+			meshletsCulled += other.meshletsCulled;
+			drawCalls += other.drawCalls;
+			instancesDrawn += other.instancesDrawn;
+			instancesCulled += other.instancesCulled;
+			boundsTested += other.boundsTested;
+			boundsCulled += other.boundsCulled;
+			bvhNodesVisited += other.bvhNodesVisited;
+			occluderTriangles += other.occluderTriangles;
+			occlusionTested += other.occlusionTested;
+			occlusionCulled += other.occlusionCulled;
+			streamedBytes += other.streamedBytes;
+			streamWaits += other.streamWaits;
+		}
+	};
+
+	Counters frame;				//counters of the frame currently being recorded
+	bool enabled = false;		//whether the averages get printed to the console
+	float reportInterval = 2.0f;
+
+	//there is only ever one renderer so the stats are a global singleton
+	static FrameStats& get()
+	{
+		static FrameStats s_stats;
+		return s_stats;
+	}
+
+	void beginFrame()
+	{
+		frame = Counters();
+		m_frameStart = std::chrono::steady_clock::now();
+	}
+
+	//should be called before swapping buffers so vsync is not counted as CPU time
+	void endFrame()
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		m_total.add(frame);
+		m_cpuSeconds += std::chrono::duration<double>(now - m_frameStart).count();
+		m_frames++;
+
+		if (std::chrono::duration<double>(now - m_windowStart).count() < reportInterval)
+			return;
+
+		if (enabled && m_frames > 0)
+			m_Print();
+
+		m_total = Counters();
+		m_cpuSeconds = 0.0;
+		m_frames = 0;
+		m_windowStart = now;
+	}
+
+private:
+	Counters m_total;
+	double m_cpuSeconds = 0.0;
+	unsigned int m_frames = 0;
+	std::chrono::steady_clock::time_point m_frameStart = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point m_windowStart = std::chrono::steady_clock::now();
+
+	//printing the per frame averages of the last reporting window
+	void m_Print()
+	{
+		double frames = (double)m_frames;
+		std::cout << "---- FRAME STATS (" << m_frames << " frames) ----" << std::endl;
+		std::cout << "CPU ms/frame: " << (m_cpuSeconds * 1000.0) / frames << std::endl;
+		std::cout << "glUniform* calls/frame: " << m_total.uniformCalls / frames << std::endl;
+		std::cout << "glGetUniformLocation calls/frame: " << m_total.locationQueries / frames << std::endl;
+		std::cout << "unchanged uniforms skipped/frame: " << m_total.uniformCallsSkipped / frames << " calls, " << m_total.uniformBytesSkipped / frames << " bytes" << std::endl;
+		std::cout << "state calls/frame: " << m_total.stateCallsIssued / frames << " issued, " << m_total.stateCallsSkipped / frames << " skipped" << std::endl;
+		std::cout << "mesh vertex KB drawn/frame: " << m_total.vertexBytes / frames / 1024.0 << std::endl;
+		std::cout << "mesh triangles/frame: " << m_total.trianglesDrawn / frames << std::endl;
+		std::cout << "meshlets/frame: " << m_total.meshletsDrawn / frames << " drawn, " << m_total.meshletsCulled / frames << " culled" << std::endl;
+		std::cout << "draw calls/frame: " << m_total.drawCalls / frames << std::endl;
+		std::cout << "instances/frame: " << m_total.instancesDrawn / frames << " drawn, " << m_total.instancesCulled / frames << " culled" << std::endl;
+		std::cout << "bounds/frame: " << m_total.boundsTested / frames << " tested, " << m_total.boundsCulled / frames << " culled" << std::endl;
+		std::cout << "scene bvh nodes visited/frame: " << m_total.bvhNodesVisited / frames << std::endl;
+		std::cout << "occlusion/frame: " << m_total.occluderTriangles / frames << " occluder triangles, " << m_total.occlusionTested / frames << " tested, "
+			<< m_total.occlusionCulled / frames << " culled" << std::endl;
+		std::cout << "streamed KB/frame: " << m_total.streamedBytes / frames / 1024.0 << ", stream waits: " << m_total.streamWaits << std::endl;
+	}
+};
+
+#endif
@@ -0,0 +1,43 @@
+#pragma once
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+//the six planes of a view volume, with normals pointing inwards
+struct Frustum {
+	glm::vec4 planes[6];		//left, right, bottom, top, near, far
+
+	//Gribb/Hartmann extraction: the planes come out in whatever space the matrix maps from,
+	//so passing projection * view * model gives planes in that model's space
+	static Frustum fromMatrix(const glm::mat4& matrix)
+	{
+		glm::vec4 rows[4];
+		for (int i = 0; i < 4; i++)
+			rows[i] = glm::vec4(matrix[0][i], matrix[1][i], matrix[2][i], matrix[3][i]);
+
+		Frustum frustum;
+		frustum.planes[0] = rows[3] + rows[0];
+		frustum.planes[1] = rows[3] - rows[0];
+		frustum.planes[2] = rows[3] + rows[1];
+		frustum.planes[3] = rows[3] - rows[1];
+		frustum.planes[4] = rows[3] + rows[2];
+		frustum.planes[5] = rows[3] - rows[2];
+
+		//normalizing so plane distances are in real units
+		for (int i = 0; i < 6; i++)
+			frustum.planes[i] /= glm::length(glm::vec3(frustum.planes[i]));
+		return frustum;
+	}
+
+	bool intersectsSphere(const glm::vec3& center, float radius) const
+	{
+		for (int i = 0; i < 6; i++) {
+			if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius)
+				return false;
+		}
+		return true;
+	}
+};
+
+#endif
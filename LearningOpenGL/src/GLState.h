@@ -0,0 +1,134 @@
+#pragma once
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#include "FrameStats.h"
+
+//thin layer that remembers the bound GL objects and drops binds that would not change anything,
+//every bind in the renderer should go through here or the cached state goes stale
+class GLState {
+public:
+	static const unsigned int MAX_TEXTURE_UNITS = 32;
+
+	static void useProgram(unsigned int programID)
+	{
+		State& state = m_State();
+		if (m_Skip(state.program == programID))
+			return;
+		state.program = programID;
+		glUseProgram(programID);
+	}
+
+	static void bindVertexArray(unsigned int vertexArrayID)
+	{
+		State& state = m_State();
+		if (m_Skip(state.vertexArray == vertexArrayID))
+			return;
+		state.vertexArray = vertexArrayID;
+		glBindVertexArray(vertexArrayID);
+	}
+
+	//binds a 2D texture to a unit, only switching the active unit when the bind actually has to happen
+	static void bindTexture(unsigned int unit, unsigned int textureID)
+	{
+		State& state = m_State();
+		if (m_Skip(unit < MAX_TEXTURE_UNITS && state.textures[unit] == textureID))
+			return;
+
+		if (state.activeUnit != unit) {
+			glActiveTexture(GL_TEXTURE0 + unit);
+			state.activeUnit = unit;
+			FrameStats::get().frame.stateCallsIssued++;
+		}
+		if (unit < MAX_TEXTURE_UNITS)
+			state.textures[unit] = textureID;
+		glBindTexture(GL_TEXTURE_2D, textureID);
+	}
+
+	//the element array binding belongs to the bound vertex array, so it is never cached
+	static void bindBuffer(GLenum target, unsigned int bufferID)
+	{
+		State& state = m_State();
+		unsigned int* cached = m_CachedBuffer(state, target);
+		if (m_Skip(cached && *cached == bufferID))
+			return;
+		if (cached)
+			*cached = bufferID;
+		glBindBuffer(target, bufferID);
+	}
+
+	//glBindBufferBase also replaces the generic binding of the target
+	static void bindBufferBase(GLenum target, unsigned int index, unsigned int bufferID)
+	{
+		State& state = m_State();
+		unsigned int* cached = m_CachedBuffer(state, target);
+		if (cached)
+			*cached = bufferID;
+		FrameStats::get().frame.stateCallsIssued++;
+		glBindBufferBase(target, index, bufferID);
+	}
+
+	//same for glBindBufferRange
+	static void bindBufferRange(GLenum target, unsigned int index, unsigned int bufferID, GLintptr offset, GLsizeiptr size)
+	{
+		State& state = m_State();
+		unsigned int* cached = m_CachedBuffer(state, target);
+		if (cached)
+			*cached = bufferID;
+		FrameStats::get().frame.stateCallsIssued++;
+		glBindBufferRange(target, index, bufferID, offset, size);
+	}
+
+	//forgetting everything, for when GL objects get deleted or something outside this layer touched the state
+	static void invalidate()
+	{
+		m_State() = State();
+	}
+
+private:
+	static const unsigned int UNKNOWN = 0xFFFFFFFF;		//forces the next bind to be issued
+
+	struct State {
+		unsigned int program = UNKNOWN;
+		unsigned int vertexArray = UNKNOWN;
+		unsigned int activeUnit = UNKNOWN;
+		unsigned int textures[MAX_TEXTURE_UNITS];
+		unsigned int arrayBuffer = UNKNOWN;
+		unsigned int uniformBuffer = UNKNOWN;
+
+		State()
+		{
+			for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++)
+				textures[i] = UNKNOWN;
+		}
+	};
+
+	static State& m_State()
+	{
+		static State s_state;
+		return s_state;
+	}
+
+	static unsigned int* m_CachedBuffer(State& state, GLenum target)
+	{
+		if (target == GL_ARRAY_BUFFER)
+			return &state.arrayBuffer;
+		if (target == GL_UNIFORM_BUFFER)
+			return &state.uniformBuffer;
+		return NULL;
+	}
+
+	//counting every request as either issued or skipped
+	static bool m_Skip(bool redundant)
+	{
+		if (redundant)
+			FrameStats::get().frame.stateCallsSkipped++;
+		else
+			FrameStats::get().frame.stateCallsIssued++;
+		return redundant;
+	}
+};
+
+#endif
@@ -0,0 +1,82 @@
+#pragma once
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include <glad/glad.h>
+
+#include <vector>
+
+#include "GLState.h"
+#include "VertexFormat.h"
+
+//one vertex buffer + element buffer shared by many meshes of the same vertex format, each mesh drawn with a base
+//vertex and an index offset from the arena's single VAO. meshes get added first and everything is uploaded at once
+class GeometryArena {
+public:
+	unsigned int VAO;
+	vertex_format format;
+
+	//where a mesh's data ended up in the buffers
+	struct Range {
+		int baseVertex;
+		size_t indexByteOffset;
+	};
+
+	GeometryArena(vertex_format format)
+	{
+		this->format = format;
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &m_VBO);
+		glGenBuffers(1, &m_EBO);
+	}
+
+	//vertexData holds vertexCount vertices of the arena's format, the indices are relative to the mesh's first vertex
+	Range add(const void* vertexData, unsigned int vertexCount, const void* indexData, size_t indexBytes)
+	{
+		//keeping every mesh's indices 4 byte aligned so 16 and 32 bit meshes can share the buffer
+		m_indexData.resize((m_indexData.size() + 3) & ~(size_t)3);
+
+		Range range;
+		range.baseVertex = (int)m_vertexCount;
+		range.indexByteOffset = m_indexData.size();
+
+		const unsigned char* vertexBytes = (const unsigned char*)vertexData;
+		const unsigned char* indexBytesData = (const unsigned char*)indexData;
+		m_vertexData.insert(m_vertexData.end(), vertexBytes, vertexBytes + (size_t)vertexCount * vertexStride(format));
+		m_indexData.insert(m_indexData.end(), indexBytesData, indexBytesData + indexBytes);
+		m_vertexCount += vertexCount;
+		m_meshCount++;
+		return range;
+	}
+
+	//creating the buffers from everything added and dropping the CPU copies
+	void upload()
+	{
+		GLState::bindVertexArray(VAO);
+		GLState::bindBuffer(GL_ARRAY_BUFFER, m_VBO);
+		glBufferData(GL_ARRAY_BUFFER, m_vertexData.size(), m_vertexData.empty() ? NULL : &m_vertexData[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indexData.size(), m_indexData.empty() ? NULL : &m_indexData[0], GL_STATIC_DRAW);
+		setupVertexAttributes(format);
+
+		m_vertexBytes = m_vertexData.size();
+		m_indexBytes = m_indexData.size();
+		std::vector<unsigned char>().swap(m_vertexData);
+		std::vector<unsigned char>().swap(m_indexData);
+	}
+
+	size_t vertexBytes() const { return m_vertexBytes; }
+	size_t indexBytes() const { return m_indexBytes; }
+	unsigned int meshCount() const { return m_meshCount; }
+
+private:
+	unsigned int m_VBO, m_EBO;
+	std::vector<unsigned char> m_vertexData;
+	std::vector<unsigned char> m_indexData;
+	unsigned int m_vertexCount = 0;
+	unsigned int m_meshCount = 0;
+	size_t m_vertexBytes = 0;
+	size_t m_indexBytes = 0;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+#ifndef INSTANCE_BATCH_H
+#define INSTANCE_BATCH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "GLState.h"
+#include "VertexFormat.h"
+#include "StreamBuffer.h"
+
+//model matrices of many copies of the same geometry, streamed as instance data so every copy gets drawn by a single
+//glDraw*Instanced call. the normal matrices get worked out here once instead of per vertex in the shader
+class InstanceBatch {
+public:
+	void clear()
+	{
+		m_instances.clear();
+	}
+
+	void add(const glm::mat4& modelMatrix)
+	{
+		m_instances.push_back(InstanceTransform(modelMatrix));
+	}
+
+	void add(const glm::mat4* modelMatrices, size_t count)
+	{
+		m_instances.reserve(m_instances.size() + count);
+		for (size_t i = 0; i < count; i++)
+			m_instances.push_back(InstanceTransform(modelMatrices[i]));
+	}
+
+	size_t size() const { return m_instances.size(); }
+	const glm::mat4& modelMatrix(size_t instance) const { return m_instances[instance].modelMatrix; }
+
+	//streams every instance to the GPU
+	unsigned int upload()
+	{
+		m_Upload(m_instances.empty() ? NULL : &m_instances[0], m_instances.size());
+		return (unsigned int)m_instances.size();
+	}
+
+	//streams only the listed instances, in that order (for culled or LOD sorted draws)
+	unsigned int upload(const std::vector<unsigned int>& order)
+	{
+		m_ordered.resize(order.size());
+		for (unsigned int i = 0; i < order.size(); i++)
+			m_ordered[i] = m_instances[order[i]];
+		m_Upload(m_ordered.empty() ? NULL : &m_ordered[0], m_ordered.size());
+		return (unsigned int)m_ordered.size();
+	}
+
+	//points the bound VAO's INSTANCED attributes at the uploaded instances starting from first, every instance
+	//decoding packed positions with the same scale and offset
+	void bindAttributes(unsigned int VAO, unsigned int first, const glm::vec3& positionScale = glm::vec3(1.0f), const glm::vec3& positionOffset = glm::vec3(0.0f))
+	{
+		InstanceAttributes::point(VAO, m_uploaded.bufferID, m_uploaded.offset + (size_t)first * sizeof(InstanceTransform), sizeof(InstanceTransform), 0);
+		InstanceAttributes::setDequantization(positionScale, positionOffset);
+	}
+
+private:
+	StreamBuffer::Allocation m_uploaded;		//where this frame's instances went
+	std::vector<InstanceTransform> m_instances;
+	std::vector<InstanceTransform> m_ordered;		//scratch for upload(order), kept to not allocate every frame
+
+	void m_Upload(const InstanceTransform* data, size_t count)
+	{
+		m_uploaded = StreamBuffer::get().write(data, count * sizeof(InstanceTransform));
+	}
+};
+
+#endif
@@ -0,0 +1,101 @@
+#pragma once
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "Shader.h"
+#include "GLState.h"
+#include "ShaderLibrary.h"
+
+struct Texture {
+	unsigned int id;
+	std::string type;			//eg: diffuse, specular, emission
+	std::string path;
+};
+
+//texture units the lighting shader's samplers are always bound to, extra textures go after these
+enum material_unit {
+	UNIT_DIFFUSE = 0,
+	UNIT_SPECULAR = 1,
+	UNIT_EMISSION = 2,
+	UNIT_FIRST_EXTRA = 3
+};
+
+//a mesh's textures resolved once at load: every texture gets a fixed unit by its role, so all programs agree on the
+//sampler values and they only get uploaded the first time a program is used with this material. drawing is then
+//just the texture binds and the shininess, no strings and no allocations
+class Material {
+public:
+	unsigned int features = 0;		//material_feature bits of the maps present
+	float shininess = 32.0f;
+
+	Material() {}
+
+	//textures follow the texture<type>N naming, where N is the number of the texture of that type
+	Material(const std::vector<Texture>& textures, float shininess = 32.0f)
+	{
+		this->shininess = shininess;
+
+		unsigned int diffuseNr = 1;
+		unsigned int specularNr = 1;
+		unsigned int emissionNr = 1;
+		unsigned int extraUnit = UNIT_FIRST_EXTRA;
+
+		for (unsigned int i = 0; i < textures.size(); i++) {
+			const std::string& name = textures[i].type;
+			unsigned int number = 0;
+			unsigned int roleUnit = 0;
+
+			//conditions for checking uniform naming
+			if (name == "textureDiffuse") {
+				number = diffuseNr++;
+				roleUnit = UNIT_DIFFUSE;
+			}
+			else if (name == "textureSpecular") {
+				number = specularNr++;
+				roleUnit = UNIT_SPECULAR;
+				features |= FEATURE_SPECULAR_MAP;
+			}
+			else if (name == "textureEmission") {
+				number = emissionNr++;
+				roleUnit = UNIT_EMISSION;
+				features |= FEATURE_EMISSION_MAP;
+			}
+
+			TextureSlot slot;
+			slot.textureID = textures[i].id;
+			slot.unit = number == 1 ? roleUnit : extraUnit++;
+			slot.uniform = "u_material." + name + std::to_string(number);
+			m_slots.push_back(slot);
+		}
+	}
+
+	//binds the textures and sets the material uniforms of the program that is in use
+	void bind(Shader& shader)
+	{
+		if (std::find(m_programsReady.begin(), m_programsReady.end(), shader.programID) == m_programsReady.end()) {
+			for (unsigned int i = 0; i < m_slots.size(); i++)
+				shader.setInt(m_slots[i].uniform.c_str(), m_slots[i].unit);
+			m_programsReady.push_back(shader.programID);
+		}
+
+		for (unsigned int i = 0; i < m_slots.size(); i++)
+			GLState::bindTexture(m_slots[i].unit, m_slots[i].textureID);
+		shader.setFloat("u_material.shininess", shininess);
+	}
+
+private:
+	struct TextureSlot {
+		unsigned int unit;
+		unsigned int textureID;
+		std::string uniform;		//only needed the first time a program sees this material
+	};
+
+	std::vector<TextureSlot> m_slots;
+	std::vector<unsigned int> m_programsReady;		//programs whose sampler uniforms already point at our units
+};
+
+#endif
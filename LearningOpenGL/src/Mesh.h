@@ -7,22 +7,43 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 
+#include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "Shader.h"
+#include "GLState.h"
+#include "Frustum.h"
+#include "ShaderLibrary.h"
+#include "Material.h"
+#include "VertexFormat.h"
+#include "GeometryArena.h"
+#include "TriangleBVH.h"
 
-struct Vertex {
-	glm::vec3 position;
-	glm::vec3 normal;
-	glm::vec2 texture;
+//simplified version of a mesh, indexing the same vertices
+struct MeshLod {
+	std::vector<unsigned int> indices;
+	float error = 0.0f;				//model space distance the surface can be off from the full mesh
+	unsigned int indexOffset = 0;	//where the indices start in the element buffer (set on upload)
+};
+
+//range of a mesh's indices, relative to the mesh's first index
+struct IndexRange {
+	unsigned int first;
+	unsigned int count;
 };
 
-struct Texture {
-	unsigned int id;
-	std::string type;			//eg: diffuse, specular, emission
-	std::string path;
+//cluster of up to 64 vertices / 124 triangles that gets culled on its own, a range of the full mesh's indices
+struct Meshlet {
+	unsigned int indexOffset;
+	unsigned int indexCount;
+	glm::vec3 center;			//bounding sphere
+	float radius;
+	glm::vec3 coneAxis;			//average facing of the triangles
+	float coneCutoff;			//sine of the cone's half angle, 1 when the triangles face too many ways to ever all be back facing
 };
 
 class Mesh {
@@ -30,79 +51,261 @@ public:
 	std::vector<Vertex> vertices;
 	std::vector<unsigned int> indices;
 	std::vector<Texture> textures;
-	unsigned int VAO;
+	Material material;				//the textures resolved into units and sampler uniforms
+	std::vector<MeshLod> lods;		//progressively coarser levels, LOD 0 being the full mesh itself
+	std::vector<Meshlet> meshlets;	//clusters of LOD 0, in index order
+	TriangleBVH collision;			//triangles of LOD 0, for ray and sphere queries in model space
+	unsigned int VAO;				//the arena's VAO, shared with every other mesh in it
+	int baseVertex = 0;				//where the mesh's vertices and indices start in the arena
+	size_t indexByteOffset = 0;
+	unsigned int features = 0;		//material_feature bits, used to pick the lighting permutation
+	vertex_format format;
+	GLenum indexType;				//GL_UNSIGNED_SHORT whenever every index fits in 16 bits
+
+	//model space bounds: the box center and half extents, and a sphere around the same center
+	glm::vec3 boundsCenter = glm::vec3(0.0f);
+	glm::vec3 boundsExtents = glm::vec3(0.0f);
+	float boundsRadius = 0.0f;
+
+	//packed positions are decoded in the vertex shader with position * scale + offset
+	glm::vec3 positionScale = glm::vec3(1.0f);
+	glm::vec3 positionOffset = glm::vec3(0.0f);
 
 	//constructor
-	Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
+	//passing an arena only records the data, the mesh is drawable once the arena got uploaded. a collision tree built
+	//along with the rest of the import gets taken over, without one it gets built here
+	Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, vertex_format format = VERTEX_FORMAT_FULL,
+		std::vector<MeshLod> lods = std::vector<MeshLod>(), std::vector<Meshlet> meshlets = std::vector<Meshlet>(), GeometryArena* arena = NULL,
+		TriangleBVH* collision = NULL)
 	{
-		this->vertices = vertices;
-		this->indices = indices;
-		this->textures = textures;
-
-		m_SetupMesh();
-	}
-
-	//assuming the uniform naming convention of textures will always be texture<type>N, where N is the number of the texture
-	void Draw(Shader& shader) {
-		unsigned int diffuseNr = 1;
-		unsigned int specularNr = 1;
-		unsigned int emissionNr = 1;
-
-		for (unsigned int i = 0; i < textures.size(); i++) {
-			glActiveTexture(GL_TEXTURE0 + i);			//incrementing nr of textures
-			std::string number;
-			std::string name = textures[i].type;
-			
-			//conditions for checking uniform naming
-			if (name == "textureDiffuse")
-				number = std::to_string(diffuseNr++);		//adding the texture number to the end of the uniform
-			
-			else if (name == "textureSpecular")
-				number = std::to_string(specularNr++);
-
-			else if (name == "textureEmission")
-				number = std::to_string(emissionNr++);
-
-			//setting the uniform for the mesh's material uniform with appropriate name and numbering
-			shader.setInt(("u_material." + name + number).c_str(), i);
-			glBindTexture(GL_TEXTURE_2D, textures[i].id);
+		this->vertices = std::move(vertices);
+		this->indices = std::move(indices);
+		this->textures = std::move(textures);
+		this->lods = std::move(lods);
+		this->meshlets = std::move(meshlets);
+		this->format = format;
+		this->indexType = this->vertices.size() <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		this->material = Material(this->textures);
+		features = material.features;
+		if (format == VERTEX_FORMAT_PACKED)
+			features |= FEATURE_PACKED_VERTICES;
+
+		m_ComputeBounds();
+		if (collision)
+			this->collision = std::move(*collision);
+		else
+			this->collision.build(this->vertices, this->indices);
+		m_SetupMesh(arena);
+	}
+
+	//size of one vertex on the GPU
+	unsigned int vertexStride() const {
+		return ::vertexStride(format);
+	}
+
+	//size of one index on the GPU
+	unsigned int indexSize() const {
+		return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+	}
+
+	//number of levels including the full mesh
+	unsigned int lodCount() const {
+		return (unsigned int)lods.size() + 1;
+	}
+
+	float lodError(unsigned int lod) const {
+		return lod == 0 ? 0.0f : lods[lod - 1].error;
+	}
+
+	//triangles of a LOD, 0 being the full mesh
+	const std::vector<unsigned int>& lodIndices(unsigned int lod) const {
+		return lod == 0 ? indices : lods[lod - 1].indices;
+	}
+
+	//first index of the mesh in the arena's element buffer
+	unsigned int firstIndex() const {
+		return (unsigned int)(indexByteOffset / indexSize());
+	}
+
+	IndexRange lodRange(unsigned int lod) const {
+		IndexRange range;
+		range.first = lod == 0 ? 0 : lods[lod - 1].indexOffset;
+		range.count = lod == 0 ? (unsigned int)indices.size() : (unsigned int)lods[lod - 1].indices.size();
+		return range;
+	}
+
+	void Draw(Shader& shader, unsigned int lod = 0) {
+		m_BindMaterial(shader);
+
+		IndexRange range = lodRange(lod);
+		FrameStats::get().frame.vertexBytes += vertices.size() * vertexStride();
+		FrameStats::get().frame.trianglesDrawn += range.count / 3;
+		FrameStats::get().frame.drawCalls++;
+
+		//actually drawing the mesh (leaving the VAO bound so the next draw of the same mesh skips the bind)
+		GLState::bindVertexArray(VAO);
+		glDrawElementsBaseVertex(GL_TRIANGLES, range.count, indexType, (void*)(indexByteOffset + (size_t)range.first * indexSize()), baseVertex);
+	}
+
+	//drawing instanceCount copies of a LOD, the instance attributes of the VAO have to point at their data already
+	void DrawInstanced(Shader& shader, unsigned int lod, unsigned int instanceCount) {
+		material.bind(shader);
+
+		IndexRange range = lodRange(lod);
+		FrameStats::get().frame.vertexBytes += vertices.size() * vertexStride();
+		FrameStats::get().frame.trianglesDrawn += (unsigned long long)(range.count / 3) * instanceCount;
+		FrameStats::get().frame.drawCalls++;
+
+		GLState::bindVertexArray(VAO);
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.count, indexType, (void*)(indexByteOffset + (size_t)range.first * indexSize()), instanceCount, baseVertex);
+	}
+
+	//finds the meshlets inside the frustum that face the viewer, frustum and viewPosition in model space.
+	//neighbouring visible meshlets are contiguous in the index buffer so they get merged into one range
+	const std::vector<IndexRange>& cullMeshlets(const Frustum& frustum, const glm::vec3& viewPosition) {
+		m_visibleRanges.clear();
+
+		unsigned int rangeEnd = 0xFFFFFFFF;
+		for (unsigned int i = 0; i < meshlets.size(); i++) {
+			const Meshlet& meshlet = meshlets[i];
+			glm::vec3 offset = meshlet.center - viewPosition;
+			bool backFacing = glm::dot(offset, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(offset) + meshlet.radius;
+			if (backFacing || !frustum.intersectsSphere(meshlet.center, meshlet.radius)) {
+				FrameStats::get().frame.meshletsCulled++;
+				continue;
+			}
+
+			if (meshlet.indexOffset == rangeEnd) {
+				m_visibleRanges.back().count += meshlet.indexCount;
+			}
+			else {
+				IndexRange range;
+				range.first = meshlet.indexOffset;
+				range.count = meshlet.indexCount;
+				m_visibleRanges.push_back(range);
+			}
+			rangeEnd = meshlet.indexOffset + meshlet.indexCount;
+			FrameStats::get().frame.meshletsDrawn++;
+		}
+		return m_visibleRanges;
+	}
+
+	//drawing the compacted list of visible meshlets in one call
+	void DrawMeshlets(Shader& shader, const Frustum& frustum, const glm::vec3& viewPosition) {
+		cullMeshlets(frustum, viewPosition);
+		if (m_visibleRanges.empty())
+			return;
+
+		m_drawCounts.clear();
+		m_drawOffsets.clear();
+		m_drawBaseVertices.clear();
+		unsigned int trianglesDrawn = 0;
+		for (unsigned int i = 0; i < m_visibleRanges.size(); i++) {
+			m_drawCounts.push_back(m_visibleRanges[i].count);
+			m_drawOffsets.push_back((const void*)(indexByteOffset + (size_t)m_visibleRanges[i].first * indexSize()));
+			m_drawBaseVertices.push_back(baseVertex);
+			trianglesDrawn += m_visibleRanges[i].count / 3;
 		}
-		glActiveTexture(GL_TEXTURE0);
 
-		//actually drawing the mesh
-		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
+		m_BindMaterial(shader);
+		FrameStats::get().frame.vertexBytes += vertices.size() * vertexStride();
+		FrameStats::get().frame.trianglesDrawn += trianglesDrawn;
+		FrameStats::get().frame.drawCalls++;
+
+		GLState::bindVertexArray(VAO);
+		glMultiDrawElementsBaseVertex(GL_TRIANGLES, &m_drawCounts[0], indexType, &m_drawOffsets[0], (GLsizei)m_drawCounts.size(), &m_drawBaseVertices[0]);
+	}
+
+	//the uniforms only the non instanced permutations read
+	void bindDrawUniforms(Shader& shader) {
+		if (format == VERTEX_FORMAT_PACKED) {
+			shader.setVec3("u_positionScale", positionScale);
+			shader.setVec3("u_positionOffset", positionOffset);
+		}
 	}
 
 private:
-	unsigned int m_VBO, m_EBO;
+	//compacted meshlet draw list, kept around so culling does not allocate every frame
+	std::vector<IndexRange> m_visibleRanges;
+	std::vector<GLsizei> m_drawCounts;
+	std::vector<const void*> m_drawOffsets;
+	std::vector<GLint> m_drawBaseVertices;
+
+	void m_BindMaterial(Shader& shader) {
+		material.bind(shader);
+		bindDrawUniforms(shader);
+	}
 	
-	void m_SetupMesh() {
-		//generating arrays and buffers
-		glGenVertexArrays(1, &VAO);
-		glGenBuffers(1, &m_VBO);
-		glGenBuffers(1, &m_EBO);
-
-		//binding arrays
-		glBindVertexArray(VAO);
-		glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-		//vertex positions
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-		//vertex normals
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));			//offsetof(s, m) where s = struct, m = variable member
-		//vertex textures
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texture));
-
-		glBindVertexArray(0);
+	void m_ComputeBounds() {
+		if (vertices.empty())
+			return;
+		glm::vec3 minimum = vertices[0].position, maximum = vertices[0].position;
+		for (unsigned int i = 1; i < vertices.size(); i++) {
+			minimum = glm::min(minimum, vertices[i].position);
+			maximum = glm::max(maximum, vertices[i].position);
+		}
+		boundsCenter = (minimum + maximum) * 0.5f;
+		boundsExtents = (maximum - minimum) * 0.5f;
+		boundsRadius = 0.0f;
+		for (unsigned int i = 0; i < vertices.size(); i++)
+			boundsRadius = glm::max(boundsRadius, glm::length(vertices[i].position - boundsCenter));
+	}
+
+	//adding the vertices and every LOD's indices to the arena (or a buffer pair of the mesh's own)
+	void m_SetupMesh(GeometryArena* arena) {
+		std::vector<unsigned int> allIndices = indices;
+		for (unsigned int i = 0; i < lods.size(); i++) {
+			lods[i].indexOffset = (unsigned int)allIndices.size();
+			allIndices.insert(allIndices.end(), lods[i].indices.begin(), lods[i].indices.end());
+		}
+
+		std::vector<uint16_t> shortIndices;
+		const void* indexData = &allIndices[0];
+		if (indexType == GL_UNSIGNED_SHORT) {
+			shortIndices.assign(allIndices.begin(), allIndices.end());
+			indexData = &shortIndices[0];
+		}
+
+		std::vector<PackedVertex> packed;
+		const void* vertexData = &vertices[0];
+		if (format == VERTEX_FORMAT_PACKED) {
+			packed = m_PackVertices();
+			vertexData = &packed[0];
+		}
+
+		//a mesh on its own gets an arena that only holds itself
+		GeometryArena ownArena(format);
+		GeometryArena* target = arena ? arena : &ownArena;
+		GeometryArena::Range range = target->add(vertexData, (unsigned int)vertices.size(), indexData, allIndices.size() * indexSize());
+		if (!arena)
+			ownArena.upload();
+
+		VAO = target->VAO;
+		baseVertex = range.baseVertex;
+		indexByteOffset = range.indexByteOffset;
+	}
+
+	//quantizing the vertices against the mesh's bounding box
+	std::vector<PackedVertex> m_PackVertices() {
+		glm::vec3 minimum(1e30f), maximum(-1e30f);
+		for (unsigned int i = 0; i < vertices.size(); i++) {
+			minimum = glm::min(minimum, vertices[i].position);
+			maximum = glm::max(maximum, vertices[i].position);
+		}
+		positionOffset = (minimum + maximum) * 0.5f;
+		positionScale = glm::max((maximum - minimum) * 0.5f, glm::vec3(1e-6f));
+
+		std::vector<PackedVertex> packed(vertices.size());
+		for (unsigned int i = 0; i < vertices.size(); i++) {
+			glm::vec3 position = (vertices[i].position - positionOffset) / positionScale;
+			for (int axis = 0; axis < 3; axis++)
+				packed[i].position[axis] = (short)glm::packSnorm1x16(position[axis]);
+			packed[i].padding = 0;
+			packed[i].normal = glm::packSnorm3x10_1x2(glm::vec4(vertices[i].normal, 0.0f));
+			packed[i].texture[0] = glm::packHalf1x16(vertices[i].texture.x);
+			packed[i].texture[1] = glm::packHalf1x16(vertices[i].texture.y);
+		}
+		return packed;
 	}
 };
 
@@ -0,0 +1,825 @@
+#pragma once
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "Mesh.h"
+
+//post transform cache efficiency of an index buffer
+struct VertexCacheStats {
+	unsigned int vertexShaderRuns = 0;		//cache misses, every one of them runs the vertex shader
+	unsigned int triangles = 0;
+	unsigned int vertices = 0;
+
+	//average cache miss ratio (3 is the worst case, ~0.5 is the best a regular grid can do)
+	float acmr() const { return triangles ? (float)vertexShaderRuns / triangles : 0.0f; }
+	//average transformed vertex ratio (1 means every vertex is shaded exactly once)
+	float atvr() const { return vertices ? (float)vertexShaderRuns / vertices : 0.0f; }
+
+	void add(const VertexCacheStats& other)
+	{
+		vertexShaderRuns += other.vertexShaderRuns;
+		triangles += other.triangles;
+		vertices += other.vertices;
+	}
+};
+
+//symmetric 4x4 error quadric (Garland & Heckbert), summing squared distances to a set of weighted planes
+struct Quadric {
+	double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+	double b0 = 0, b1 = 0, b2 = 0, c = 0;
+	double weight = 0;
+
+	//plane through point with a unit normal
+	static Quadric fromPlane(const glm::vec3& normal, const glm::vec3& point, double planeWeight)
+	{
+		Quadric q;
+		double x = normal.x, y = normal.y, z = normal.z;
+		double d = -(x * point.x + y * point.y + z * point.z);
+		q.a00 = x * x * planeWeight; q.a01 = x * y * planeWeight; q.a02 = x * z * planeWeight;
+		q.a11 = y * y * planeWeight; q.a12 = y * z * planeWeight; q.a22 = z * z * planeWeight;
+		q.b0 = x * d * planeWeight; q.b1 = y * d * planeWeight; q.b2 = z * d * planeWeight;
+		q.c = d * d * planeWeight;
+		q.weight = planeWeight;
+		return q;
+	}
+
+	void add(const Quadric& other)
+	{
+		a00 += other.a00; a01 += other.a01; a02 += other.a02;
+		a11 += other.a11; a12 += other.a12; a22 += other.a22;
+		b0 += other.b0; b1 += other.b1; b2 += other.b2;
+		c += other.c;
+		weight += other.weight;
+	}
+
+	//weighted mean squared distance of a point to the planes
+	double error(const glm::vec3& p) const
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double e = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+			+ 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+		return weight > 0.0 ? glm::abs(e) / weight : 0.0;
+	}
+};
+
+//import time passes that reorder index and vertex buffers so the GPU does less work for the same triangles
+class MeshOptimizer {
+public:
+	//size of the FIFO the statistics and the overdraw clustering simulate
+	static const unsigned int FIFO_CACHE_SIZE = 16;
+
+	//runs all three passes in the order they depend on each other
+	static void optimize(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+	{
+		optimizeVertexCache(indices, (unsigned int)vertices.size());
+		optimizeOverdraw(indices, vertices, 1.05f);
+		optimizeVertexFetch(vertices, indices);
+	}
+
+	//merging vertices whose attributes are bitwise identical (-0 counting as 0) and pointing the indices at the one
+	//that stays. an empty index list reads the vertices as a plain triangle list
+	static void weldVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+	{
+		if (indices.empty()) {
+			indices.resize(vertices.size());
+			for (unsigned int i = 0; i < vertices.size(); i++)
+				indices[i] = i;
+		}
+
+		std::unordered_map<Vertex, unsigned int, VertexHash, VertexEqual> first;
+		first.reserve(vertices.size());
+		std::vector<unsigned int> remap(vertices.size());
+		std::vector<Vertex> welded;
+		welded.reserve(vertices.size());
+		for (unsigned int i = 0; i < vertices.size(); i++) {
+			std::pair<std::unordered_map<Vertex, unsigned int, VertexHash, VertexEqual>::iterator, bool> inserted =
+				first.insert(std::make_pair(m_CanonicalVertex(vertices[i]), (unsigned int)welded.size()));
+			if (inserted.second)
+				welded.push_back(vertices[i]);
+			remap[i] = inserted.first->second;
+		}
+
+		for (unsigned int i = 0; i < indices.size(); i++)
+			indices[i] = remap[indices[i]];
+		vertices.swap(welded);
+	}
+
+	//simulating a FIFO post transform cache over the index buffer
+	static VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize = FIFO_CACHE_SIZE)
+	{
+		VertexCacheStats stats;
+		stats.triangles = (unsigned int)(indices.size() / 3);
+		stats.vertices = vertexCount;
+
+		//a vertex is in the cache while the miss counter has not moved more than cacheSize past its own timestamp
+		std::vector<unsigned int> timestamps(vertexCount, 0);
+		unsigned int time = cacheSize + 1;
+		for (unsigned int i = 0; i < indices.size(); i++) {
+			unsigned int index = indices[i];
+			if (time - timestamps[index] > cacheSize) {
+				timestamps[index] = time++;
+				stats.vertexShaderRuns++;
+			}
+		}
+		return stats;
+	}
+
+	//Tom Forsyth's linear speed vertex cache optimisation, greedily emitting the best scoring triangle each step
+	static void optimizeVertexCache(std::vector<unsigned int>& indices, unsigned int vertexCount)
+	{
+		unsigned int triangleCount = (unsigned int)(indices.size() / 3);
+		if (triangleCount == 0)
+			return;
+
+		//triangles that use each vertex, packed into one array
+		std::vector<unsigned int> offsets(vertexCount + 1, 0);
+		for (unsigned int i = 0; i < indices.size(); i++)
+			offsets[indices[i] + 1]++;
+		for (unsigned int i = 0; i < vertexCount; i++)
+			offsets[i + 1] += offsets[i];
+
+		std::vector<unsigned int> adjacency(indices.size());
+		std::vector<unsigned int> remaining(vertexCount, 0);		//triangles left to emit per vertex
+		for (unsigned int i = 0; i < indices.size(); i++) {
+			unsigned int vertex = indices[i];
+			adjacency[offsets[vertex] + remaining[vertex]++] = i / 3;
+		}
+
+		std::vector<int> cachePosition(vertexCount, -1);
+		std::vector<float> vertexScore(vertexCount);
+		for (unsigned int i = 0; i < vertexCount; i++)
+			vertexScore[i] = m_ForsythScore(-1, remaining[i]);
+
+		std::vector<bool> emitted(triangleCount, false);
+		unsigned int cursor = 0;		//lowest triangle that might not be emitted yet
+
+		//the cache holds FORSYTH_CACHE_SIZE entries plus room for the three vertices that are pushed each step
+		unsigned int cache[FORSYTH_CACHE_SIZE + 3];
+		unsigned int cacheCount = 0;
+
+		std::vector<unsigned int> result;
+		result.reserve(indices.size());
+
+		int best = 0;
+		for (unsigned int r = 1; r <= triangleCount; r++) {
+			for (unsigned int k = 0; k < 3; k++)
+				result.push_back(indices[best * 3 + k]);
+			emitted[best] = true;
+
+			//pushing the triangle's vertices to the front of the cache
+			unsigned int next[FORSYTH_CACHE_SIZE + 6];
+			unsigned int nextCount = 0;
+			for (unsigned int k = 0; k < 3; k++)
+				next[nextCount++] = indices[best * 3 + k];
+			for (unsigned int k = 0; k < cacheCount; k++) {
+				unsigned int vertex = cache[k];
+				if (vertex != next[0] && vertex != next[1] && vertex != next[2])
+					next[nextCount++] = vertex;
+			}
+
+			//removing the triangle from its vertices' adjacency
+			for (unsigned int k = 0; k < 3; k++) {
+				unsigned int vertex = indices[best * 3 + k];
+				unsigned int* begin = &adjacency[offsets[vertex]];
+				unsigned int* end = begin + remaining[vertex];
+				*std::find(begin, end, (unsigned int)best) = *(end - 1);
+				remaining[vertex]--;
+			}
+
+			//rescoring every vertex that moved in or out of the cache, then the triangles that use them
+			cacheCount = std::min(nextCount, FORSYTH_CACHE_SIZE);
+			for (unsigned int k = 0; k < nextCount; k++) {
+				unsigned int vertex = next[k];
+				if (k < cacheCount)
+					cache[k] = vertex;
+				cachePosition[vertex] = k < cacheCount ? (int)k : -1;
+				vertexScore[vertex] = m_ForsythScore(cachePosition[vertex], remaining[vertex]);
+			}
+
+			best = -1;
+			float bestScore = -1.0f;
+			for (unsigned int k = 0; k < nextCount; k++) {
+				unsigned int vertex = next[k];
+				for (unsigned int t = offsets[vertex]; t < offsets[vertex] + remaining[vertex]; t++) {
+					unsigned int triangle = adjacency[t];
+					float score = vertexScore[indices[triangle * 3]] + vertexScore[indices[triangle * 3 + 1]] + vertexScore[indices[triangle * 3 + 2]];
+					if (score > bestScore) {
+						bestScore = score;
+						best = (int)triangle;
+					}
+				}
+			}
+
+			//nothing left touching the cache, so starting over at the next triangle in the original order
+			if (best == -1 && r < triangleCount) {
+				while (emitted[cursor])
+					cursor++;
+				best = (int)cursor;
+			}
+		}
+
+		indices.swap(result);
+	}
+
+	//Tipsify style overdraw pass: splits the cache optimised order into clusters where the cache restarts anyway
+	//and sorts those so outward facing ones come first, only keeping splits that cost less than threshold x ACMR
+	static void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, float threshold)
+	{
+		unsigned int triangleCount = (unsigned int)(indices.size() / 3);
+		if (triangleCount == 0)
+			return;
+
+		std::vector<unsigned int> clusters = m_OverdrawClusters(indices, (unsigned int)vertices.size(), threshold);
+
+		//area weighted centroid of the whole mesh
+		glm::vec3 meshCentroid(0.0f);
+		float meshArea = 0.0f;
+		for (unsigned int i = 0; i < triangleCount; i++) {
+			glm::vec3 a = vertices[indices[i * 3]].position, b = vertices[indices[i * 3 + 1]].position, c = vertices[indices[i * 3 + 2]].position;
+			float area = glm::length(glm::cross(b - a, c - a));
+			meshCentroid += (a + b + c) * (area / 3.0f);
+			meshArea += area;
+		}
+		if (meshArea > 0.0f)
+			meshCentroid /= meshArea;
+
+		//clusters facing away from the centre occlude the rest, so they are drawn first
+		std::vector<float> sortKey(clusters.size());
+		for (unsigned int cluster = 0; cluster < clusters.size(); cluster++) {
+			unsigned int end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangleCount;
+			glm::vec3 centroid(0.0f), normal(0.0f);
+			float area = 0.0f;
+			for (unsigned int i = clusters[cluster]; i < end; i++) {
+				glm::vec3 a = vertices[indices[i * 3]].position, b = vertices[indices[i * 3 + 1]].position, c = vertices[indices[i * 3 + 2]].position;
+				glm::vec3 cross = glm::cross(b - a, c - a);
+				float triangleArea = glm::length(cross);
+				centroid += (a + b + c) * (triangleArea / 3.0f);
+				normal += cross;
+				area += triangleArea;
+			}
+			if (area > 0.0f)
+				centroid /= area;
+			float length = glm::length(normal);
+			sortKey[cluster] = length > 0.0f ? glm::dot(centroid - meshCentroid, normal / length) : 0.0f;
+		}
+
+		std::vector<unsigned int> order(clusters.size());
+		for (unsigned int c = 0; c < order.size(); c++)
+			order[c] = c;
+		std::stable_sort(order.begin(), order.end(), [&sortKey](unsigned int a, unsigned int b) { return sortKey[a] > sortKey[b]; });
+
+		std::vector<unsigned int> result;
+		result.reserve(indices.size());
+		for (unsigned int o = 0; o < order.size(); o++) {
+			unsigned int c = order[o];
+			unsigned int end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+			result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + end * 3);
+		}
+		indices.swap(result);
+	}
+
+	//renumbering vertices in the order the index buffer first touches them, dropping unused ones
+	static void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+	{
+		const unsigned int UNUSED = 0xFFFFFFFF;
+		std::vector<unsigned int> remap(vertices.size(), UNUSED);
+		std::vector<Vertex> result;
+		result.reserve(vertices.size());
+
+		for (unsigned int i = 0; i < indices.size(); i++) {
+			unsigned int& target = remap[indices[i]];
+			if (target == UNUSED) {
+				target = (unsigned int)result.size();
+				result.push_back(vertices[indices[i]]);
+			}
+			indices[i] = target;
+		}
+		vertices.swap(result);
+	}
+
+	//quadric error edge collapse down to targetIndexCount, never moving the surface further than targetError,
+	//the result indexes the same vertex buffer and error receives the distance the surface actually moved.
+	//vertices only collapse onto neighbours, borders only along themselves, and UV/normal seams (two vertices sharing
+	//a position) only collapse when both sides can follow the same seam edge, so no cracks or attribute smears appear
+	static std::vector<unsigned int> simplify(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, unsigned int targetIndexCount, float targetError, float* error)
+	{
+		unsigned int vertexCount = (unsigned int)vertices.size();
+		std::vector<unsigned int> result = indices;
+		std::vector<unsigned int> sibling = m_PositionSiblings(vertices);
+
+		Adjacency adjacency;
+		m_BuildAdjacency(adjacency, result, vertexCount);
+
+		std::vector<Quadric> quadrics(vertexCount);
+		m_FillQuadrics(quadrics, vertices, result, adjacency);
+
+		double maxError = 0.0;
+		double errorLimit = (double)targetError * targetError;
+		std::vector<unsigned int> collapseTo(vertexCount);
+		std::vector<bool> touched(vertexCount);
+
+		while (result.size() > targetIndexCount) {
+			//what every vertex is allowed to do this pass
+			std::vector<unsigned char> kind(vertexCount);
+			std::vector<unsigned int> openOut(vertexCount), openIn(vertexCount);
+			m_ClassifyVertices(kind, openOut, openIn, vertices, sibling, result, adjacency);
+
+			std::vector<Collapse> collapses;
+			for (unsigned int i = 0; i < result.size(); i++) {
+				unsigned int from = result[i];
+				unsigned int to = result[i - i % 3 + (i + 1) % 3];
+				m_AddCollapse(collapses, from, to, kind, openOut, openIn, sibling, vertices, quadrics);
+				m_AddCollapse(collapses, to, from, kind, openOut, openIn, sibling, vertices, quadrics);
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+			//applying the cheapest collapses whose neighbourhoods do not overlap
+			for (unsigned int i = 0; i < vertexCount; i++)
+				collapseTo[i] = i;
+			std::fill(touched.begin(), touched.end(), false);
+
+			size_t triangles = result.size() / 3;
+			size_t targetTriangles = targetIndexCount / 3;
+			unsigned int applied = 0;
+			for (unsigned int i = 0; i < collapses.size() && triangles > targetTriangles; i++) {
+				const Collapse& collapse = collapses[i];
+				if (collapse.error > errorLimit)
+					break;
+				if (touched[collapse.from] || touched[collapse.to])
+					continue;
+				if (collapse.twinFrom != collapse.from && (touched[collapse.twinFrom] || touched[collapse.twinTo]))
+					continue;
+				if (m_FlipsTriangle(collapse.from, collapse.to, vertices, result, adjacency))
+					continue;
+				if (collapse.twinFrom != collapse.from && m_FlipsTriangle(collapse.twinFrom, collapse.twinTo, vertices, result, adjacency))
+					continue;
+
+				m_LockNeighbourhood(touched, collapse.from, sibling, result, adjacency);
+				collapseTo[collapse.from] = collapse.to;
+				quadrics[collapse.to].add(quadrics[collapse.from]);
+				if (collapse.twinFrom != collapse.from) {
+					m_LockNeighbourhood(touched, collapse.twinFrom, sibling, result, adjacency);
+					collapseTo[collapse.twinFrom] = collapse.twinTo;
+					quadrics[collapse.twinTo].add(quadrics[collapse.twinFrom]);
+				}
+
+				maxError = glm::max(maxError, collapse.error);
+				triangles -= kind[collapse.from] == VERTEX_BORDER ? 1 : 2;
+				applied++;
+			}
+			if (applied == 0)
+				break;
+
+			//remapping the collapsed vertices and dropping the triangles that became degenerate
+			unsigned int write = 0;
+			for (unsigned int i = 0; i < result.size(); i += 3) {
+				unsigned int a = collapseTo[result[i]], b = collapseTo[result[i + 1]], c = collapseTo[result[i + 2]];
+				if (a == b || b == c || c == a)
+					continue;
+				result[write++] = a;
+				result[write++] = b;
+				result[write++] = c;
+			}
+			result.resize(write);
+			m_BuildAdjacency(adjacency, result, vertexCount);
+		}
+
+		if (error)
+			*error = (float)std::sqrt(maxError);
+		return result;
+	}
+
+	//cutting the index buffer into meshlets in order, so each one stays a contiguous index range.
+	//run it on cache optimised indices, their order already keeps neighbouring triangles together
+	static std::vector<Meshlet> buildMeshlets(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, unsigned int maxVertices = 64, unsigned int maxTriangles = 124)
+	{
+		std::vector<Meshlet> meshlets;
+		std::vector<unsigned int> lastMeshlet(vertices.size(), 0xFFFFFFFF);		//which meshlet counted the vertex last
+
+		unsigned int start = 0, vertexCount = 0;
+		for (unsigned int i = 0; i < indices.size(); i += 3) {
+			if (vertexCount + m_NewVertices(indices, i, lastMeshlet, (unsigned int)meshlets.size()) > maxVertices || (i - start) / 3 >= maxTriangles) {
+				meshlets.push_back(m_MeshletBounds(vertices, indices, start, i - start));
+				start = i;
+				vertexCount = 0;
+			}
+
+			unsigned int meshletID = (unsigned int)meshlets.size();
+			vertexCount += m_NewVertices(indices, i, lastMeshlet, meshletID);
+			for (unsigned int k = 0; k < 3; k++)
+				lastMeshlet[indices[i + k]] = meshletID;
+		}
+		if (start < indices.size())
+			meshlets.push_back(m_MeshletBounds(vertices, indices, start, (unsigned int)indices.size() - start));
+		return meshlets;
+	}
+
+private:
+	static const unsigned int FORSYTH_CACHE_SIZE = 32;
+
+	//how many distinct vertices of a triangle the meshlet does not have yet
+	static unsigned int m_NewVertices(const std::vector<unsigned int>& indices, unsigned int first, const std::vector<unsigned int>& lastMeshlet, unsigned int meshletID)
+	{
+		unsigned int a = indices[first], b = indices[first + 1], c = indices[first + 2];
+		unsigned int count = lastMeshlet[a] != meshletID ? 1 : 0;
+		if (b != a && lastMeshlet[b] != meshletID)
+			count++;
+		if (c != a && c != b && lastMeshlet[c] != meshletID)
+			count++;
+		return count;
+	}
+
+	//bounding sphere around the box of the meshlet's vertices and the cone containing all its triangle normals
+	static Meshlet m_MeshletBounds(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, unsigned int indexOffset, unsigned int indexCount)
+	{
+		Meshlet meshlet;
+		meshlet.indexOffset = indexOffset;
+		meshlet.indexCount = indexCount;
+
+		glm::vec3 minimum(1e30f), maximum(-1e30f);
+		for (unsigned int i = indexOffset; i < indexOffset + indexCount; i++) {
+			minimum = glm::min(minimum, vertices[indices[i]].position);
+			maximum = glm::max(maximum, vertices[indices[i]].position);
+		}
+		meshlet.center = (minimum + maximum) * 0.5f;
+		meshlet.radius = 0.0f;
+		for (unsigned int i = indexOffset; i < indexOffset + indexCount; i++)
+			meshlet.radius = glm::max(meshlet.radius, glm::length(vertices[indices[i]].position - meshlet.center));
+
+		//the axis is the average facing, the cutoff comes from the normal furthest away from it
+		std::vector<glm::vec3> normals;
+		glm::vec3 axis(0.0f);
+		for (unsigned int i = indexOffset; i < indexOffset + indexCount; i += 3) {
+			glm::vec3 a = vertices[indices[i]].position, b = vertices[indices[i + 1]].position, c = vertices[indices[i + 2]].position;
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			float length = glm::length(normal);
+			if (length <= 0.0f)
+				continue;
+			normals.push_back(normal / length);
+			axis += normals.back();
+		}
+
+		meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+		meshlet.coneCutoff = 1.0f;
+		float axisLength = glm::length(axis);
+		if (axisLength <= 0.0f)
+			return meshlet;
+		axis /= axisLength;
+
+		float minimumDot = 1.0f;
+		for (unsigned int i = 0; i < normals.size(); i++)
+			minimumDot = glm::min(minimumDot, glm::dot(normals[i], axis));
+
+		//a cone wider than a hemisphere can never be entirely back facing
+		meshlet.coneAxis = axis;
+		if (minimumDot > 0.0f)
+			meshlet.coneCutoff = glm::sqrt(1.0f - minimumDot * minimumDot);
+		return meshlet;
+	}
+
+	//how a vertex may collapse during simplification
+	enum vertex_kind : unsigned char {
+		VERTEX_MANIFOLD,		//closed fan, can collapse onto any neighbour
+		VERTEX_BORDER,			//on an open edge, only collapses along it
+		VERTEX_SEAM,			//one of two vertices sharing a position, collapses along the seam together with its twin
+		VERTEX_LOCKED			//corners, seams with more than two sides, non manifold fans
+	};
+
+	//triangles around every vertex, packed into one array
+	struct Adjacency {
+		std::vector<unsigned int> offsets;
+		std::vector<unsigned int> triangles;
+
+		unsigned int begin(unsigned int vertex) const { return offsets[vertex]; }
+		unsigned int end(unsigned int vertex) const { return offsets[vertex + 1]; }
+	};
+
+	struct Collapse {
+		unsigned int from, to;
+		unsigned int twinFrom, twinTo;		//the other side of a seam (same as from/to everywhere else)
+		double error;
+	};
+
+	static void m_BuildAdjacency(Adjacency& adjacency, const std::vector<unsigned int>& indices, unsigned int vertexCount)
+	{
+		adjacency.offsets.assign(vertexCount + 1, 0);
+		for (unsigned int i = 0; i < indices.size(); i++)
+			adjacency.offsets[indices[i] + 1]++;
+		for (unsigned int i = 0; i < vertexCount; i++)
+			adjacency.offsets[i + 1] += adjacency.offsets[i];
+
+		adjacency.triangles.resize(indices.size());
+		std::vector<unsigned int> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+		for (unsigned int i = 0; i < indices.size(); i++)
+			adjacency.triangles[fill[indices[i]]++] = i / 3;
+	}
+
+	//whether a triangle has the directed edge from -> to
+	static bool m_HasEdge(unsigned int from, unsigned int to, const std::vector<unsigned int>& indices, const Adjacency& adjacency)
+	{
+		for (unsigned int t = adjacency.begin(from); t < adjacency.end(from); t++) {
+			const unsigned int* triangle = &indices[adjacency.triangles[t] * 3];
+			for (unsigned int k = 0; k < 3; k++) {
+				if (triangle[k] == from && triangle[(k + 1) % 3] == to)
+					return true;
+			}
+		}
+		return false;
+	}
+
+	//linking vertices that share a position into rings (sibling[v] == v when the position is unique)
+	static std::vector<unsigned int> m_PositionSiblings(const std::vector<Vertex>& vertices)
+	{
+		std::vector<unsigned int> sibling(vertices.size());
+		std::unordered_map<glm::vec3, unsigned int, PositionHash> first;
+		first.reserve(vertices.size());
+		for (unsigned int i = 0; i < vertices.size(); i++) {
+			std::pair<std::unordered_map<glm::vec3, unsigned int, PositionHash>::iterator, bool> inserted = first.insert(std::make_pair(vertices[i].position, i));
+			if (inserted.second) {
+				sibling[i] = i;
+			}
+			else {
+				unsigned int head = inserted.first->second;
+				sibling[i] = sibling[head];
+				sibling[head] = i;
+			}
+		}
+		return sibling;
+	}
+
+	//hashing and comparing the raw bits of every attribute, so welding only merges exact copies
+	struct VertexHash {
+		size_t operator()(const Vertex& vertex) const
+		{
+			unsigned int bits[sizeof(Vertex) / sizeof(unsigned int)];
+			std::memcpy(bits, &vertex, sizeof(bits));
+			size_t hash = 2166136261u;
+			for (unsigned int i = 0; i < sizeof(bits) / sizeof(bits[0]); i++)
+				hash = (hash ^ bits[i]) * 16777619u;
+			return hash;
+		}
+	};
+
+	struct VertexEqual {
+		bool operator()(const Vertex& a, const Vertex& b) const
+		{
+			return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+		}
+	};
+
+	//adding 0 turns -0 into 0 and leaves everything else as it is
+	static Vertex m_CanonicalVertex(const Vertex& vertex)
+	{
+		Vertex canonical;
+		canonical.position = vertex.position + glm::vec3(0.0f);
+		canonical.normal = vertex.normal + glm::vec3(0.0f);
+		canonical.texture = vertex.texture + glm::vec2(0.0f);
+		return canonical;
+	}
+
+	struct PositionHash {
+		size_t operator()(const glm::vec3& position) const
+		{
+			unsigned int bits[3];
+			std::memcpy(bits, &position, sizeof(bits));
+			return (size_t)((bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u));
+		}
+	};
+
+	//area weighted triangle planes, plus planes standing on open edges so borders and seams keep their shape
+	static void m_FillQuadrics(std::vector<Quadric>& quadrics, const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const Adjacency& adjacency)
+	{
+		for (unsigned int i = 0; i < indices.size(); i += 3) {
+			glm::vec3 a = vertices[indices[i]].position, b = vertices[indices[i + 1]].position, c = vertices[indices[i + 2]].position;
+			glm::vec3 cross = glm::cross(b - a, c - a);
+			float area = glm::length(cross);
+			if (area <= 0.0f)
+				continue;
+			glm::vec3 normal = cross / area;
+
+			Quadric plane = Quadric::fromPlane(normal, a, area);
+			for (unsigned int k = 0; k < 3; k++)
+				quadrics[indices[i + k]].add(plane);
+
+			for (unsigned int k = 0; k < 3; k++) {
+				unsigned int from = indices[i + k], to = indices[i + (k + 1) % 3];
+				if (m_HasEdge(to, from, indices, adjacency))
+					continue;
+				glm::vec3 edge = vertices[to].position - vertices[from].position;
+				float length = glm::length(edge);
+				if (length <= 0.0f)
+					continue;
+				Quadric border = Quadric::fromPlane(glm::normalize(glm::cross(edge, normal)), vertices[from].position, length * length);
+				quadrics[from].add(border);
+				quadrics[to].add(border);
+			}
+		}
+	}
+
+	static void m_ClassifyVertices(std::vector<unsigned char>& kind, std::vector<unsigned int>& openOut, std::vector<unsigned int>& openIn,
+		const std::vector<Vertex>& vertices, const std::vector<unsigned int>& sibling, const std::vector<unsigned int>& indices, const Adjacency& adjacency)
+	{
+		const unsigned int NONE = 0xFFFFFFFF;
+		unsigned int vertexCount = (unsigned int)kind.size();
+		std::vector<unsigned int> outCount(vertexCount, 0), inCount(vertexCount, 0);
+
+		//open edges are the ones no triangle walks the other way
+		for (unsigned int i = 0; i < vertexCount; i++) {
+			openOut[i] = NONE;
+			openIn[i] = NONE;
+		}
+		for (unsigned int i = 0; i < indices.size(); i++) {
+			unsigned int from = indices[i];
+			unsigned int to = indices[i - i % 3 + (i + 1) % 3];
+			if (!m_HasEdge(to, from, indices, adjacency)) {
+				openOut[from] = to;
+				openIn[to] = from;
+				outCount[from]++;
+				inCount[to]++;
+			}
+		}
+
+		for (unsigned int i = 0; i < vertexCount; i++) {
+			bool unique = sibling[i] == i;
+			bool singleOpen = outCount[i] == 1 && inCount[i] == 1;
+
+			if (unique && outCount[i] == 0 && inCount[i] == 0)
+				kind[i] = VERTEX_MANIFOLD;
+			else if (unique && singleOpen)
+				kind[i] = VERTEX_BORDER;
+			else if (!unique && sibling[sibling[i]] == i && singleOpen) {
+				//the twin has to run along the same seam edges in the opposite direction
+				unsigned int twin = sibling[i];
+				bool twinOpen = outCount[twin] == 1 && inCount[twin] == 1;
+				if (twinOpen && vertices[openOut[twin]].position == vertices[openIn[i]].position && vertices[openIn[twin]].position == vertices[openOut[i]].position)
+					kind[i] = VERTEX_SEAM;
+				else
+					kind[i] = VERTEX_LOCKED;
+			}
+			else
+				kind[i] = VERTEX_LOCKED;
+		}
+	}
+
+	static void m_AddCollapse(std::vector<Collapse>& collapses, unsigned int from, unsigned int to, const std::vector<unsigned char>& kind,
+		const std::vector<unsigned int>& openOut, const std::vector<unsigned int>& openIn, const std::vector<unsigned int>& sibling,
+		const std::vector<Vertex>& vertices, const std::vector<Quadric>& quadrics)
+	{
+		Collapse collapse;
+		collapse.from = collapse.twinFrom = from;
+		collapse.to = collapse.twinTo = to;
+
+		switch (kind[from]) {
+		case VERTEX_MANIFOLD:
+			break;
+		case VERTEX_BORDER:
+			if (to != openOut[from] && to != openIn[from])
+				return;
+			break;
+		case VERTEX_SEAM: {
+			unsigned int twin = sibling[from];
+			if (to == openOut[from])
+				collapse.twinTo = openIn[twin];
+			else if (to == openIn[from])
+				collapse.twinTo = openOut[twin];
+			else
+				return;
+			collapse.twinFrom = twin;
+			break;
+		}
+		default:
+			return;
+		}
+
+		Quadric quadric = quadrics[from];
+		quadric.add(quadrics[to]);
+		if (collapse.twinFrom != from) {
+			quadric.add(quadrics[collapse.twinFrom]);
+			quadric.add(quadrics[collapse.twinTo]);
+		}
+		collapse.error = quadric.error(vertices[to].position);
+		collapses.push_back(collapse);
+	}
+
+	//whether moving from onto to would turn any of its remaining triangles over
+	static bool m_FlipsTriangle(unsigned int from, unsigned int to, const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const Adjacency& adjacency)
+	{
+		for (unsigned int t = adjacency.begin(from); t < adjacency.end(from); t++) {
+			const unsigned int* triangle = &indices[adjacency.triangles[t] * 3];
+			if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+				continue;
+
+			glm::vec3 before[3], after[3];
+			for (unsigned int k = 0; k < 3; k++) {
+				before[k] = vertices[triangle[k]].position;
+				after[k] = triangle[k] == from ? vertices[to].position : before[k];
+			}
+			glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+			glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+			if (glm::dot(normalBefore, normalAfter) <= 0.0f)
+				return true;
+		}
+		return false;
+	}
+
+	//a collapse changes every triangle around from, so nothing in that fan (or sharing a position with it) may move this pass
+	static void m_LockNeighbourhood(std::vector<bool>& touched, unsigned int from, const std::vector<unsigned int>& sibling, const std::vector<unsigned int>& indices, const Adjacency& adjacency)
+	{
+		for (unsigned int t = adjacency.begin(from); t < adjacency.end(from); t++) {
+			const unsigned int* triangle = &indices[adjacency.triangles[t] * 3];
+			for (unsigned int k = 0; k < 3; k++) {
+				unsigned int vertex = triangle[k];
+				do {
+					touched[vertex] = true;
+					vertex = sibling[vertex];
+				} while (vertex != triangle[k]);
+			}
+		}
+	}
+
+	//vertex score from Forsyth's article: recently used vertices and ones with few triangles left score highest
+	static float m_ForsythScore(int cachePosition, unsigned int remaining)
+	{
+		if (remaining == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0) {
+			//the last triangle's vertices get a fixed score so the next triangle does not just reuse them
+			if (cachePosition < 3)
+				score = 0.75f;
+			else
+				score = std::pow(1.0f - (float)(cachePosition - 3) / (FORSYTH_CACHE_SIZE - 3), 1.5f);
+		}
+		return score + 2.0f / std::sqrt((float)remaining);
+	}
+
+	//first triangle of every cluster: a new cluster starts wherever all three vertices miss the cache (hard boundary),
+	//and hard clusters get split further where the miss ratio so far is within threshold of the whole cluster's
+	static std::vector<unsigned int> m_OverdrawClusters(const std::vector<unsigned int>& indices, unsigned int vertexCount, float threshold)
+	{
+		unsigned int triangleCount = (unsigned int)(indices.size() / 3);
+		std::vector<unsigned int> timestamps(vertexCount, 0);
+		unsigned int time = FIFO_CACHE_SIZE + 1;
+
+		std::vector<unsigned int> hard;
+		for (unsigned int i = 0; i < triangleCount; i++) {
+			unsigned int misses = m_SimulateTriangle(indices, i, timestamps, time);
+			if (i == 0 || misses == 3)
+				hard.push_back(i);
+		}
+
+		std::vector<unsigned int> clusters;
+		for (unsigned int h = 0; h < hard.size(); h++) {
+			unsigned int start = hard[h];
+			unsigned int end = h + 1 < hard.size() ? hard[h + 1] : triangleCount;
+
+			//miss ratio of the cluster in one piece, from a cold cache
+			time += FIFO_CACHE_SIZE + 1;		//ageing every entry out of the cache
+			unsigned int clusterMisses = 0;
+			for (unsigned int i = start; i < end; i++)
+				clusterMisses += m_SimulateTriangle(indices, i, timestamps, time);
+			float clusterACMR = (float)clusterMisses / (end - start);
+
+			//splitting whenever the cold started piece so far is already as cheap as the whole cluster
+			time += FIFO_CACHE_SIZE + 1;		//ageing every entry out of the cache
+			clusters.push_back(start);
+			unsigned int pieceStart = start, pieceMisses = 0;
+			for (unsigned int i = start; i < end; i++) {
+				pieceMisses += m_SimulateTriangle(indices, i, timestamps, time);
+				unsigned int pieceTriangles = i + 1 - pieceStart;
+				if (i + 1 < end && (float)pieceMisses / pieceTriangles <= threshold * clusterACMR) {
+					clusters.push_back(i + 1);
+					pieceStart = i + 1;
+					pieceMisses = 0;
+					time += FIFO_CACHE_SIZE + 1;
+				}
+			}
+		}
+		return clusters;
+	}
+
+	//cache misses of one triangle in a FIFO simulation
+	static unsigned int m_SimulateTriangle(const std::vector<unsigned int>& indices, unsigned int triangle, std::vector<unsigned int>& timestamps, unsigned int& time)
+	{
+		unsigned int misses = 0;
+		for (unsigned int k = 0; k < 3; k++) {
+			unsigned int index = indices[triangle * 3 + k];
+			if (time - timestamps[index] > FIFO_CACHE_SIZE) {
+				timestamps[index] = time++;
+				misses++;
+			}
+		}
+		return misses;
+	}
+};
+
+#endif
@@ -2,6 +2,14 @@
 
 #include <glad/glad.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -10,16 +18,108 @@
 #include <assimp/postprocess.h>
 
 #include "Shader.h"
+#include "ShaderLibrary.h"
 #include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "DrawBatch.h"
+#include "InstanceBatch.h"
+#include "CullBatch.h"
+#include "OcclusionCuller.h"
+#include "ThreadPool.h"
 #include "stb_image.h"
 
 
+//what LOD selection and meshlet culling need to know about the camera
+struct DrawView {
+	glm::mat4 viewProjection;
+	Frustum frustum;				//world space planes of viewProjection
+	glm::vec3 position;
+	float projectionScale;			//pixels a unit long object covers at distance 1 (screen height / (2 * tan(fov / 2)))
+	float maxPixelError = 1.0f;		//how far on screen a simplified surface may be off
+};
+
+//LOD levels generated per mesh (on top of the full one) and how hard each one tries to simplify
+const unsigned int MAX_MESH_LODS = 4;
+const float LOD_MAX_RELATIVE_ERROR = 0.05f;		//relative to the mesh's bounding box diagonal
+//how far an occluder LOD may be off in occlusion buffer pixels, below half a pixel an edge can only move past the
+//pixel centers right next to it
+const float OCCLUDER_MAX_PIXEL_ERROR = 0.5f;
+
+//blocking loads are done when the constructor returns, asynchronous ones import on the thread pool and only get
+//uploaded once Model::finishLoads picks them up on the context thread
+enum model_loading {
+	MODEL_LOAD_BLOCKING,
+	MODEL_LOAD_ASYNC
+};
+
 class Model {
 public:
 	//constructor
-	Model(const char* path, bool flipUvs)
+	Model(const char* path, bool flipUvs, vertex_format format = VERTEX_FORMAT_FULL, model_loading loading = MODEL_LOAD_BLOCKING) : m_arena(format)
 	{
-		m_LoadModel(path, flipUvs);			//immediately loads the model based on path
+		if (loading == MODEL_LOAD_ASYNC)
+			m_StartLoad(path, flipUvs);
+		else
+			m_LoadModel(path, flipUvs);			//immediately loads the model based on path
+	}
+
+	~Model()
+	{
+		//an import still running stops at its next job and gets dropped
+		if (m_pending) {
+			m_pending->model = NULL;
+			m_pending->cancelled = true;
+		}
+	}
+
+	//false while an asynchronous load has not been finished yet, until then the model has no meshes and no bounds
+	bool ready() const { return m_ready; }
+
+	//uploading the next model whose background import is done, called once per frame on the context thread. only
+	//one model per call, so a frame never pays for more than one model's uploads. returns how many got finished
+	static unsigned int finishLoads() {
+		std::shared_ptr<PendingLoad> load;
+		{
+			LoadQueue& queue = m_LoadQueue();
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			//models destroyed while importing have nothing to upload to
+			while (!queue.finished.empty() && !queue.finished.front()->model)
+				queue.finished.pop_front();
+			if (queue.finished.empty())
+				return 0;
+			load = queue.finished.front();
+			queue.finished.pop_front();
+		}
+
+		Model* model = load->model;
+		model->m_pending.reset();
+		model->m_Publish(load->path, load->succeeded, load->imported, load->importMs);
+		return 1;
+	}
+
+	//model space bounds of all meshes, a box (center + half extents) and a sphere around the same center
+	glm::vec3 boundsCenter = glm::vec3(0.0f);
+	glm::vec3 boundsExtents = glm::vec3(0.0f);
+	float boundsRadius = 0.0f;
+
+	//collision trees of every mesh, all in the model's space
+	void collisionMeshes(std::vector<const TriangleBVH*>& trees) const {
+		for (unsigned int i = 0; i < m_meshes.size(); i++)
+			trees.push_back(&m_meshes[i].collision);
+	}
+
+	//adding every mesh as an occluder seen from viewPosition, at the coarsest LOD whose error stays under
+	//OCCLUDER_MAX_PIXEL_ERROR pixels of the occlusion buffer. a simplified surface can bulge past the real one, so
+	//close up (or whenever no LOD is that accurate) the full mesh gets rasterized
+	void addOccluders(OcclusionCuller& occlusion, const glm::mat4& modelMatrix, const glm::vec3& viewPosition) const {
+		DrawView occlusionView;
+		occlusionView.position = viewPosition;
+		occlusionView.projectionScale = occlusion.projectionScale();
+		float pixelsPerUnit = m_PixelsPerUnit(modelMatrix, occlusionView);
+		for (unsigned int i = 0; i < m_meshes.size(); i++) {
+			unsigned int lod = m_SelectLod(m_meshes[i], pixelsPerUnit, OCCLUDER_MAX_PIXEL_ERROR);
+			occlusion.addOccluder(modelMatrix, m_meshes[i].vertices, m_meshes[i].lodIndices(lod));
+		}
 	}
 
 	//drawing the full model based on the amount of meshes found
@@ -29,163 +129,570 @@ public:
 		}
 	}
 
+	//drawing each mesh with the cheapest permutation that fits its material and the lights reaching the model,
+	//at the coarsest LOD whose error stays under a pixel from where the view is. meshes outside the frustum are skipped
+	//and at full detail the meshlets get culled too
+	void Draw(ShaderLibrary& library, const glm::mat4& modelMatrix, const LightSelection& lights, const DrawView& view) {
+		float pixelsPerUnit = m_PixelsPerUnit(modelMatrix, view);
+
+		//meshlets get culled in model space
+		Frustum modelFrustum = Frustum::fromMatrix(view.viewProjection * modelMatrix);
+		glm::vec3 modelViewPosition = glm::vec3(glm::inverse(modelMatrix) * glm::vec4(view.position, 1.0f));
+
+		m_CullMeshes(modelMatrix, view);
+		for (unsigned int i = 0; i < m_meshes.size(); i++) {
+			Shader& shader = library.get(m_meshes[i].features, lights.count);
+			if (!m_meshCulling.visible(i) || !shader.isReady())
+				continue;
+
+			shader.useProgram();
+			shader.setMat4("u_modelMatrix", modelMatrix);
+			ShaderLibrary::applyLightSelection(shader, lights);
+
+			unsigned int lod = m_SelectLod(m_meshes[i], pixelsPerUnit, view.maxPixelError);
+			if (lod == 0 && !m_meshes[i].meshlets.empty())
+				m_meshes[i].DrawMeshlets(shader, modelFrustum, modelViewPosition);
+			else
+				m_meshes[i].Draw(shader, lod);
+		}
+	}
+
+	//same selection as Draw, but the draws are only recorded into the batch with the model matrix (and each mesh's
+	//dequantization) as their instance data, so they get submitted together with everything else sharing state
+	void Submit(DrawBatch& batch, ShaderLibrary& library, const glm::mat4& modelMatrix, const LightSelection& lights, const DrawView& view) {
+		float pixelsPerUnit = m_PixelsPerUnit(modelMatrix, view);
+		Frustum modelFrustum = Frustum::fromMatrix(view.viewProjection * modelMatrix);
+		glm::vec3 modelViewPosition = glm::vec3(glm::inverse(modelMatrix) * glm::vec4(view.position, 1.0f));
+
+		m_CullMeshes(modelMatrix, view);
+		for (unsigned int i = 0; i < m_meshes.size(); i++) {
+			Mesh& mesh = m_meshes[i];
+			Shader& shader = library.get(mesh.features | FEATURE_INSTANCED, lights.count);
+			if (!m_meshCulling.visible(i) || !shader.isReady())
+				continue;
+
+			unsigned int instance = batch.addInstance(modelMatrix, mesh.positionScale, mesh.positionOffset);
+			FrameStats::get().frame.vertexBytes += mesh.vertices.size() * mesh.vertexStride();
+
+			unsigned int lod = m_SelectLod(mesh, pixelsPerUnit, view.maxPixelError);
+			if (lod == 0 && !mesh.meshlets.empty()) {
+				const std::vector<IndexRange>& ranges = mesh.cullMeshlets(modelFrustum, modelViewPosition);
+				for (unsigned int r = 0; r < ranges.size(); r++)
+					batch.addDraw(shader, mesh.material, lights, mesh.VAO, mesh.indexType, mesh.firstIndex() + ranges[r].first, ranges[r].count, mesh.baseVertex, instance);
+			}
+			else {
+				IndexRange range = mesh.lodRange(lod);
+				batch.addDraw(shader, mesh.material, lights, mesh.VAO, mesh.indexType, mesh.firstIndex() + range.first, range.count, mesh.baseVertex, instance);
+			}
+		}
+	}
+
+	//drawing every copy in the batch that is inside the view with one instanced draw per mesh and LOD. the visible
+	//copies get sorted from closest to furthest on screen, so each LOD of a mesh is one contiguous run of instances
+	void DrawInstanced(ShaderLibrary& library, InstanceBatch& instances, const LightSelection& lights, const DrawView& view) {
+		bool hasLods = false;
+		for (unsigned int i = 0; i < m_meshes.size(); i++)
+			hasLods = hasLods || !m_meshes[i].lods.empty();
+
+		m_instanceCulling.clear();
+		for (unsigned int i = 0; i < instances.size(); i++)
+			m_instanceCulling.add(instances.modelMatrix(i), boundsCenter, boundsExtents, boundsRadius);
+		m_instanceCulling.cull(view.frustum);
+
+		m_instanceDetail.clear();
+		for (unsigned int i = 0; i < instances.size(); i++) {
+			if (!m_instanceCulling.visible(i)) {
+				FrameStats::get().frame.instancesCulled++;
+				continue;
+			}
+			m_instanceDetail.push_back(std::make_pair(hasLods ? m_PixelsPerUnit(instances.modelMatrix(i), view) : 0.0f, i));
+		}
+		if (m_instanceDetail.empty())
+			return;
+
+		//most pixels per unit first, so LODs go from finest to coarsest along the buffer
+		if (hasLods)
+			std::sort(m_instanceDetail.begin(), m_instanceDetail.end(), std::greater<std::pair<float, unsigned int> >());
+		m_instanceOrder.resize(m_instanceDetail.size());
+		for (unsigned int i = 0; i < m_instanceDetail.size(); i++)
+			m_instanceOrder[i] = m_instanceDetail[i].second;
+		unsigned int visible = instances.upload(m_instanceOrder);
+		FrameStats::get().frame.instancesDrawn += visible;
+
+		for (unsigned int i = 0; i < m_meshes.size(); i++) {
+			Mesh& mesh = m_meshes[i];
+			Shader& shader = library.get(mesh.features | FEATURE_INSTANCED, lights.count);
+			if (!shader.isReady())
+				continue;
+
+			shader.useProgram();
+			ShaderLibrary::applyLightSelection(shader, lights);
+			GLState::bindVertexArray(mesh.VAO);
+
+			unsigned int start = 0;
+			while (start < visible) {
+				unsigned int lod = m_SelectLod(mesh, m_instanceDetail[start].first, view.maxPixelError);
+				unsigned int end = start + 1;
+				while (end < visible && m_SelectLod(mesh, m_instanceDetail[end].first, view.maxPixelError) == lod)
+					end++;
+
+				instances.bindAttributes(mesh.VAO, start, mesh.positionScale, mesh.positionOffset);
+				mesh.DrawInstanced(shader, lod, end - start);
+				start = end;
+			}
+		}
+	}
+
+	//same as above for a plain array of model matrices
+	void DrawInstanced(ShaderLibrary& library, const glm::mat4* modelMatrices, size_t count, const LightSelection& lights, const DrawView& view) {
+		m_instances.clear();
+		m_instances.add(modelMatrices, count);
+		DrawInstanced(library, m_instances, lights, view);
+	}
+
+	//material features of every mesh, so the matching permutations can be precompiled
+	unsigned int featureSets() const {
+		unsigned int sets = 0;
+		for (unsigned int i = 0; i < m_meshes.size(); i++)
+			sets |= 1u << m_meshes[i].features;
+		return sets;
+	}
+
 private:
+	//a texture file of the model decoded on the CPU, waiting for its GL upload
+	struct ImportedTexture {
+		std::string path;				//as the material names it, relative to the model's directory
+		std::string type;				//the sampler role of the first material using it
+		unsigned char* data = NULL;		//stb_image pixels, freed by the upload
+		int width = 0, height = 0, components = 0;
+	};
+
+	//a converted aiMesh with everything derived from it, only missing its textures and GL buffers
+	struct ImportedMesh {
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		std::vector<MeshLod> lods;
+		std::vector<Meshlet> meshlets;
+		TriangleBVH collision;
+		std::vector<unsigned int> textures;		//into ImportedModel::textures
+		size_t importedVertices = 0;			//before welding
+		VertexCacheStats cacheBefore, cacheAfter;
+	};
+
+	//what the CPU side of an import produces, none of it needs the GL context
+	struct ImportedModel {
+		std::string directory;
+		std::vector<ImportedMesh> meshes;
+		std::vector<ImportedTexture> textures;
+
+		ImportedModel() = default;
+		ImportedModel(const ImportedModel&) = delete;
+		ImportedModel& operator=(const ImportedModel&) = delete;
+
+		//pixels of textures that never got uploaded (the import failed or the model is gone)
+		~ImportedModel() {
+			for (unsigned int i = 0; i < textures.size(); i++)
+				stbi_image_free(textures[i].data);
+		}
+	};
+
+	//an asynchronous load, shared by the import job and the queue it gets published through
+	struct PendingLoad {
+		Model* model = NULL;			//only touched on the context thread, NULL once the model is destroyed
+		std::atomic<bool> cancelled{ false };		//set with model going NULL, the import checks it between jobs
+		std::string path;
+		ImportedModel imported;
+		bool succeeded = false;
+		double importMs = 0.0;
+	};
+
+	//imports that are done on the thread pool, waiting for the context thread
+	struct LoadQueue {
+		std::mutex mutex;
+		std::deque<std::shared_ptr<PendingLoad> > finished;
+	};
+
 	//model data
+	bool m_ready = false;
+	std::shared_ptr<PendingLoad> m_pending;		//the asynchronous load in flight, if any
 	std::vector<Texture> m_texturesLoaded;
 	std::vector<Mesh> m_meshes;
-	std::string m_directory;
+	GeometryArena m_arena;		//every mesh's vertices and indices, so drawing the model binds one VAO
+
+	//instanced draw scratch: the model's own batch for DrawInstanced with matrices, and the visible instances
+	//with their pixels per unit, kept around so drawing does not allocate every frame
+	InstanceBatch m_instances;
+	CullBatch m_instanceCulling;
+	CullBatch m_meshCulling;		//world bounds of every mesh for the model matrix being drawn
+	std::vector<std::pair<float, unsigned int> > m_instanceDetail;
+	std::vector<unsigned int> m_instanceOrder;
+
+	size_t m_importedVertices = 0;		//vertices assimp handed over, before welding
+
+	//vertex cache efficiency of every mesh before and after the optimisation passes
+	VertexCacheStats m_cacheBefore;
+	VertexCacheStats m_cacheAfter;
+
+	static LoadQueue& m_LoadQueue() {
+		static LoadQueue s_queue;
+		return s_queue;
+	}
 
 	void m_LoadModel(std::string path, bool flipUvs) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		ImportedModel imported;
+		bool succeeded = m_Import(path, flipUvs, imported);
+		double importMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		m_Publish(path, succeeded, imported, importMs);
+	}
+
+	//handing the import to a worker, the model stays empty until finishLoads publishes it
+	void m_StartLoad(std::string path, bool flipUvs) {
+		m_pending = std::make_shared<PendingLoad>();
+		m_pending->model = this;
+		m_pending->path = path;
+
+		//every static the import touches has to exist before the pool does, so it is still there when the pool joins
+		//its workers at exit (statics get destroyed in the reverse order they were created in)
+		m_LoadQueue();
+		TriangleBVH::cacheDirectory();
+		std::shared_ptr<PendingLoad> load = m_pending;
+		ThreadPool::get().submit([load, flipUvs]() {
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			load->succeeded = m_Import(load->path, flipUvs, load->imported, &load->cancelled);
+			load->importMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			if (load->cancelled)
+				return;
+
+			LoadQueue& queue = m_LoadQueue();
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.finished.push_back(load);
+		});
+	}
+
+	//the context thread's part of both ways of loading, a failed import leaves the model ready but empty
+	void m_Publish(const std::string& path, bool succeeded, ImportedModel& imported, double importMs) {
+		m_ready = true;
+		if (!succeeded)
+			return;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		m_Finish(imported);
+		double uploadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		m_ReportImport(path);
+		std::cout << path << ": imported in " << importMs << " ms on " << ThreadPool::get().threadCount() << " threads, GL uploads took "
+			<< uploadMs << " ms" << std::endl;
+	}
+
+	//the CPU half of loading: reading the file, then converting every mesh and decoding every texture on the thread
+	//pool. touches no GL and no member, so it can run on any thread. once cancelled is set it skips what is left and
+	//fails
+	static bool m_Import(const std::string& path, bool flipUvs, ImportedModel& imported, const std::atomic<bool>* cancelled = NULL) {
 		//creating importer object to read file path and execute post processing options of ASSIMP
 		Assimp::Importer importer;
 		const aiScene* scene;
+		//identical vertices get welded by MeshOptimizer::weldVertices once the meshes are converted
+		unsigned int flags = aiProcess_Triangulate;
 		if (flipUvs) {
-			scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+			scene = importer.ReadFile(path, flags | aiProcess_FlipUVs);
 		}
 		else {
-			scene = importer.ReadFile(path, aiProcess_Triangulate);
+			scene = importer.ReadFile(path, flags);
 		}
 
 
 		//error logging if no scene exists / flags are incomplete
 		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
 			std::cout << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
+			return false;
+		}
+
+		if (cancelled && *cancelled)
+			return false;
+
+		imported.directory = path.substr(0, path.find_last_of('/'));
+		std::vector<aiMesh*> meshes;
+		m_ProcessNode(scene->mRootNode, scene, meshes);
+
+		//working out which files the meshes use first, every texture gets decoded once however many meshes share it
+		imported.meshes.resize(meshes.size());
+		for (unsigned int i = 0; i < meshes.size(); i++) {
+			if (meshes[i]->mMaterialIndex >= 0) {
+				aiMaterial* material = scene->mMaterials[meshes[i]->mMaterialIndex];
+				m_LoadMaterialTexture(material, aiTextureType_DIFFUSE, "textureDiffuse", imported, imported.meshes[i].textures);
+				m_LoadMaterialTexture(material, aiTextureType_SPECULAR, "textureSpecular", imported, imported.meshes[i].textures);
+			}
+		}
+
+		//the textures go first, decoding them is the longest work
+		unsigned int textureCount = (unsigned int)imported.textures.size();
+		ThreadPool::get().parallelFor(textureCount + (unsigned int)meshes.size(), [&](unsigned int job) {
+			if (cancelled && *cancelled)
+				return;
+			if (job < textureCount)
+				m_DecodeTexture(imported.textures[job], imported.directory);
+			else
+				m_ProcessMesh(meshes[job - textureCount], imported.meshes[job - textureCount]);
+		});
+		return !(cancelled && *cancelled);
+	}
+
+	//the GL half of loading, on the thread owning the context: uploading the textures, placing the meshes in the arena
+	//and creating its buffers
+	void m_Finish(ImportedModel& imported) {
+		for (unsigned int i = 0; i < imported.textures.size(); i++) {
+			Texture texture;
+			texture.id = m_TextureFromFile(imported.textures[i], imported.directory);
+			texture.type = imported.textures[i].type;
+			texture.path = imported.textures[i].path;
+			m_texturesLoaded.push_back(texture);		//adding to loaded textures vector
+		}
+
+		m_meshes.reserve(imported.meshes.size());
+		for (unsigned int i = 0; i < imported.meshes.size(); i++) {
+			ImportedMesh& mesh = imported.meshes[i];
+			std::vector<Texture> textures;
+			for (unsigned int j = 0; j < mesh.textures.size(); j++)
+				textures.push_back(m_texturesLoaded[mesh.textures[j]]);
+
+			m_importedVertices += mesh.importedVertices;
+			m_cacheBefore.add(mesh.cacheBefore);
+			m_cacheAfter.add(mesh.cacheAfter);
+			m_meshes.push_back(Mesh(std::move(mesh.vertices), std::move(mesh.indices), textures, m_arena.format, std::move(mesh.lods), std::move(mesh.meshlets),
+				&m_arena, &mesh.collision));
+		}
+		m_arena.upload();
+		m_ComputeBounds();
+	}
+
+	//comparing the GPU memory of the chosen vertex format and index types against full floats and 32 bit indices,
+	//and how much the optimisation passes improved the vertex cache
+	void m_ReportImport(const std::string& path) {
+		size_t vertexCount = 0, indexCount = 0;
+		size_t vertexBytes = 0, indexBytes = 0;
+		unsigned int shortMeshes = 0;
+		for (unsigned int i = 0; i < m_meshes.size(); i++) {
+			vertexCount += m_meshes[i].vertices.size();
+			vertexBytes += m_meshes[i].vertices.size() * m_meshes[i].vertexStride();
+			size_t meshIndices = m_meshes[i].indices.size();
+			for (unsigned int j = 0; j < m_meshes[i].lods.size(); j++)
+				meshIndices += m_meshes[i].lods[j].indices.size();
+			indexCount += meshIndices;
+			indexBytes += meshIndices * m_meshes[i].indexSize();
+			if (m_meshes[i].indexType == GL_UNSIGNED_SHORT)
+				shortMeshes++;
+		}
+		size_t fullVertexBytes = vertexCount * sizeof(Vertex);
+		size_t fullIndexBytes = indexCount * sizeof(uint32_t);
+		std::cout << path << ": " << vertexCount << " vertices (welded from " << m_importedVertices << "), " << vertexBytes / 1024.0 << " KB vertex memory (" << fullVertexBytes / 1024.0 << " KB as full floats)" << std::endl;
+		std::cout << path << ": " << indexCount << " indices, " << shortMeshes << "/" << m_meshes.size() << " meshes with 16 bit indices, "
+			<< indexBytes / 1024.0 << " KB index memory (" << (fullIndexBytes - indexBytes) / 1024.0 << " KB saved)" << std::endl;
+
+		//triangles of every LOD level summed over the meshes
+		std::cout << path << ": LOD triangles";
+		for (unsigned int lod = 0; lod <= MAX_MESH_LODS; lod++) {
+			size_t triangles = 0;
+			for (unsigned int i = 0; i < m_meshes.size(); i++) {
+				unsigned int level = glm::min(lod, m_meshes[i].lodCount() - 1);
+				triangles += (level == 0 ? m_meshes[i].indices.size() : m_meshes[i].lods[level - 1].indices.size()) / 3;
+			}
+			std::cout << (lod == 0 ? " " : " / ") << triangles;
+		}
+		std::cout << std::endl;
+		std::cout << path << ": ACMR " << m_cacheBefore.acmr() << " -> " << m_cacheAfter.acmr()
+			<< ", ATVR " << m_cacheBefore.atvr() << " -> " << m_cacheAfter.atvr() << " (" << MeshOptimizer::FIFO_CACHE_SIZE << " entry FIFO)" << std::endl;
+
+		size_t meshlets = 0;
+		for (unsigned int i = 0; i < m_meshes.size(); i++)
+			meshlets += m_meshes[i].meshlets.size();
+		std::cout << path << ": " << meshlets << " meshlets" << std::endl;
+		std::cout << path << ": " << m_arena.meshCount() << " meshes in one arena, " << m_arena.vertexBytes() / 1024.0 << " KB vertices + "
+			<< m_arena.indexBytes() / 1024.0 << " KB indices behind 1 VAO" << std::endl;
+	}
+
+	//bounding sphere around the box of every vertex
+	void m_ComputeBounds() {
+		glm::vec3 minimum(1e30f), maximum(-1e30f);
+		for (unsigned int i = 0; i < m_meshes.size(); i++) {
+			for (unsigned int j = 0; j < m_meshes[i].vertices.size(); j++) {
+				minimum = glm::min(minimum, m_meshes[i].vertices[j].position);
+				maximum = glm::max(maximum, m_meshes[i].vertices[j].position);
+			}
+		}
+		if (minimum.x > maximum.x)
 			return;
+
+		boundsCenter = (minimum + maximum) * 0.5f;
+		boundsExtents = (maximum - minimum) * 0.5f;
+		boundsRadius = 0.0f;
+		for (unsigned int i = 0; i < m_meshes.size(); i++) {
+			for (unsigned int j = 0; j < m_meshes[i].vertices.size(); j++)
+				boundsRadius = glm::max(boundsRadius, glm::length(m_meshes[i].vertices[j].position - boundsCenter));
 		}
+	}
 
-		m_directory = path.substr(0, path.find_last_of('/'));
-		m_ProcessNode(scene->mRootNode, scene);
+	//frustum testing every mesh's bounds under one model matrix, results in m_meshCulling
+	void m_CullMeshes(const glm::mat4& modelMatrix, const DrawView& view) {
+		m_meshCulling.clear();
+		for (unsigned int i = 0; i < m_meshes.size(); i++)
+			m_meshCulling.add(modelMatrix, m_meshes[i].boundsCenter, m_meshes[i].boundsExtents, m_meshes[i].boundsRadius);
+		m_meshCulling.cull(view.frustum);
 	}
 
-	//recursively processing each node
-	void m_ProcessNode(aiNode* node, const aiScene* scene) {
+	//screen pixels per model space unit at the closest point of the bounding sphere
+	float m_PixelsPerUnit(const glm::mat4& modelMatrix, const DrawView& view) const {
+		float scale = glm::max(glm::max(glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1]))), glm::length(glm::vec3(modelMatrix[2])));
+		glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(boundsCenter, 1.0f));
+		float distance = glm::length(center - view.position) - boundsRadius * scale;
+		return distance > 0.0f ? view.projectionScale * scale / distance : 1e30f;
+	}
+
+	//coarsest level whose error stays under maxPixelError on screen
+	static unsigned int m_SelectLod(const Mesh& mesh, float pixelsPerUnit, float maxPixelError) {
+		unsigned int lod = mesh.lodCount() - 1;
+		while (lod > 0 && mesh.lodError(lod) * pixelsPerUnit > maxPixelError)
+			lod--;
+		return lod;
+	}
+
+	//simplifying each level from the one before until it stops getting meaningfully smaller
+	static std::vector<MeshLod> m_BuildLods(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices) {
+		std::vector<MeshLod> lods;
+		glm::vec3 minimum(1e30f), maximum(-1e30f);
+		for (unsigned int i = 0; i < vertices.size(); i++) {
+			minimum = glm::min(minimum, vertices[i].position);
+			maximum = glm::max(maximum, vertices[i].position);
+		}
+		if (vertices.empty())
+			return lods;
+		float maxError = glm::length(maximum - minimum) * LOD_MAX_RELATIVE_ERROR;
+
+		const std::vector<unsigned int>* source = &indices;
+		float error = 0.0f;
+		for (unsigned int level = 0; level < MAX_MESH_LODS && error < maxError; level++) {
+			unsigned int target = (unsigned int)(source->size() / 6) * 3;
+			float levelError = 0.0f;
+			MeshLod lod;
+			lod.indices = MeshOptimizer::simplify(vertices, *source, target, maxError - error, &levelError);
+			if (lod.indices.empty() || lod.indices.size() > source->size() * 8 / 10)
+				break;
+
+			//errors of a chain add up since each level only knows the one before it
+			error += levelError;
+			lod.error = error;
+			MeshOptimizer::optimizeVertexCache(lod.indices, (unsigned int)vertices.size());
+			lods.push_back(lod);
+			source = &lods.back().indices;
+		}
+		return lods;
+	}
+
+	//collecting the meshes of every node, depth first
+	static void m_ProcessNode(aiNode* node, const aiScene* scene, std::vector<aiMesh*>& meshes) {
 		//processing all the node's meshes if there are any
 		for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-			aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-			m_meshes.push_back(m_ProcessMesh(mesh, scene));
+			meshes.push_back(scene->mMeshes[node->mMeshes[i]]);
 		}
 
 		//then do the same for each node's children
 		for (unsigned int i = 0; i < node->mNumChildren; i++) {
-			m_ProcessNode(node->mChildren[i], scene);
+			m_ProcessNode(node->mChildren[i], scene, meshes);
 		}
 	}
 
+	//converting one aiMesh and deriving its LODs, meshlets and collision tree, runs on the thread pool
+	static void m_ProcessMesh(const aiMesh* mesh, ImportedMesh& imported) {
+		std::vector<Vertex>& vertices = imported.vertices;
+		std::vector<unsigned int>& indices = imported.indices;
 
-	Mesh m_ProcessMesh(aiMesh* mesh, const aiScene* scene) {
-		std::vector<Vertex> vertices;
-		std::vector<unsigned int> indices;
-		std::vector<Texture> textures;
-
-		//processing vertices
+		//processing vertices, written in place into a buffer of the exact size
+		vertices.resize(mesh->mNumVertices);
 		for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-			Vertex vertex;
-			glm::vec3 vector;
+			Vertex& vertex = vertices[i];
 
 			//positions
-			vector.x = mesh->mVertices[i].x;
-			vector.y = mesh->mVertices[i].y;
-			vector.z = mesh->mVertices[i].z;
-			vertex.position = vector;
+			vertex.position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
 
 			//normals
-			vector.x = mesh->mNormals[i].x;
-			vector.y = mesh->mNormals[i].y;
-			vector.z = mesh->mNormals[i].z;
-			vertex.normal = vector;
+			vertex.normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
 
 			//textures
 			if (mesh->mTextureCoords[0]) {				//if there are any textures in the first place
-				glm::vec2 vec;
-				vec.x = mesh->mTextureCoords[0][i].x;
-				vec.y = mesh->mTextureCoords[0][i].y;
-				vertex.texture = vec;
+				vertex.texture = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
 			}
 			else {										//else set default texture values to 0f
 				vertex.texture = glm::vec2(0.0f);
 			}
-			vertices.push_back(vertex);
 		}
 
-		//processing indices
+		//processing indices, counted first so they get the same treatment
+		size_t indexCount = 0;
+		for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+			indexCount += mesh->mFaces[i].mNumIndices;
+		indices.resize(indexCount);
+		size_t index = 0;
 		for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
-			aiFace face = mesh->mFaces[i];
+			const aiFace& face = mesh->mFaces[i];
 			for (unsigned int j = 0; j < face.mNumIndices; j++) {
-				indices.push_back(face.mIndices[j]);
+				indices[index++] = face.mIndices[j];
 			}
 		}
 
-		//processing materials
-		if (mesh->mMaterialIndex >= 0) {
-			aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+		//joining identical vertices, or there is no reuse for the vertex cache pass to work with
+		imported.importedVertices = vertices.size();
+		MeshOptimizer::weldVertices(vertices, indices);
 
-			//loading diffuse maps
-			std::vector<Texture> diffuseMaps = m_LoadMaterialTexture(material, aiTextureType_DIFFUSE, "textureDiffuse");
-			textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+		//reordering for the post transform cache, overdraw and vertex fetch
+		imported.cacheBefore = MeshOptimizer::analyzeVertexCache(indices, (unsigned int)vertices.size());
+		MeshOptimizer::optimize(vertices, indices);
+		imported.cacheAfter = MeshOptimizer::analyzeVertexCache(indices, (unsigned int)vertices.size());
 
-			//loading specular maps
-			std::vector<Texture> specularMaps = m_LoadMaterialTexture(material, aiTextureType_SPECULAR, "textureSpecular");
-			textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-		}
-
-		return Mesh(vertices, indices, textures);
+		imported.lods = m_BuildLods(vertices, indices);
+		imported.meshlets = MeshOptimizer::buildMeshlets(vertices, indices);
+		imported.collision.build(vertices, indices);
 	}
 
-	//loading the material textures based on the type that was specified
-	std::vector<Texture> m_LoadMaterialTexture(aiMaterial* material, aiTextureType type, std::string typeName) {
-		std::vector<Texture> textures;
-
+	//adding the material's textures of a type to the mesh's list, files not seen before get queued for decoding
+	static void m_LoadMaterialTexture(aiMaterial* material, aiTextureType type, std::string typeName, ImportedModel& imported, std::vector<unsigned int>& textures) {
 		for (unsigned int i = 0; i < material->GetTextureCount(type); i++) {
 			aiString str;
 			material->GetTexture(type, i, &str);
 			bool skip = false;
-			std::string fullPath = m_directory + '/' + str.C_Str();
-			
-			//if the texture has been loaded previously, break the loop
-			for (unsigned int j = 0; j < m_texturesLoaded.size(); j++) {
-				
-				//CURRENTLY: testing changes to ensure texture file names that match don't get reused in other models
-				/*
-				if (m_texturesLoaded[j].path == fullPath) {
-					textures.push_back(m_texturesLoaded[j]);
-					skip = true;
-					break;
-				}
-				*/
 
-				if (std::strcmp(m_texturesLoaded[j].path.data(), str.C_Str()) == 0) {
-					textures.push_back(m_texturesLoaded[j]);
+			//if the texture has been loaded previously, break the loop
+			for (unsigned int j = 0; j < imported.textures.size(); j++) {
+				if (std::strcmp(imported.textures[j].path.data(), str.C_Str()) == 0) {
+					textures.push_back(j);
 					skip = true;
 					break;
 				}
-				
 			}
 
 			//if the texture has not been loaded already, then load it
 			if (!skip) {
-				Texture texture;
-				texture.id = m_TextureFromFile(str.C_Str(), m_directory);		//old
-				//texture.id = m_TextureFromFile(fullPath.c_str(), "");
+				ImportedTexture texture;
 				texture.type = typeName;
 				texture.path = str.C_Str();
-				//texture.path = fullPath;
-				textures.push_back(texture);
-				m_texturesLoaded.push_back(texture);		//adding to loaded textures vector
+				textures.push_back((unsigned int)imported.textures.size());
+				imported.textures.push_back(texture);
 			}
 		}
-		return textures;
 	}
 
-	//loading textures from a file
-	unsigned int m_TextureFromFile(const char* path, const std::string &directory) {
-		std::string fileName = std::string(path);
-		fileName = directory + '/' + fileName;
+	//decoding a texture file on the thread pool (stb_image is safe to call from several threads)
+	static void m_DecodeTexture(ImportedTexture& texture, const std::string& directory) {
+		std::string fileName = directory + '/' + texture.path;
+		texture.data = stbi_load(fileName.c_str(), &texture.width, &texture.height, &texture.components, 0);
+	}
 
+	//creating the GL texture of a decoded file
+	unsigned int m_TextureFromFile(ImportedTexture& texture, const std::string &directory) {
 		unsigned int textureID;
 		glGenTextures(1, &textureID);
 
-		int width, height, nrComponents;
-		unsigned char* data = stbi_load(fileName.c_str(), &width, &height, &nrComponents, 0);
+		int width = texture.width, height = texture.height, nrComponents = texture.components;
+		unsigned char* data = texture.data;
+		texture.data = NULL;
 
 		if (data)
 		{
@@ -198,7 +705,7 @@ private:
 				textureFormat = GL_RGBA;
 
 			//binding the texture
-			glBindTexture(GL_TEXTURE_2D, textureID);
+			GLState::bindTexture(0, textureID);
 			glTexImage2D(GL_TEXTURE_2D, 0, textureFormat, width, height, 0, textureFormat, GL_UNSIGNED_BYTE, data);
 			glGenerateMipmap(GL_TEXTURE_2D);
 			//texture wrapping + mipmapping
@@ -211,7 +718,7 @@ private:
 		}
 		else
 		{
-			std::cout << "Failed to load texture at path: " << path << std::endl;
+			std::cout << "Failed to load texture at path: " << directory << '/' << texture.path << std::endl;
 			stbi_image_free(data);
 		}
 		return textureID;
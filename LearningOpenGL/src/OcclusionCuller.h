@@ -0,0 +1,286 @@
+#pragma once
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#define OCCLUSION_CULLER_SSE
+#endif
+
+#include "VertexFormat.h"
+#include "FrameStats.h"
+#include "ThreadPool.h"
+
+//software occlusion culling: a few big occluders get rasterized on the CPU into a small depth buffer and every
+//object's bounding box is tested against it before it gets submitted, so what is hidden behind them never reaches the
+//fragment shaders. the buffer is split into horizontal bands rasterized by the thread pool, each band drawing 4
+//pixels per SSE step, and every 8x8 tile keeps its furthest depth so most boxes are decided without looking at pixels.
+//depths are view distances (clip w) and every occluder triangle is written at its furthest vertex's distance, which
+//keeps the buffer from ever claiming something is closer than it is
+class OcclusionCuller {
+public:
+	static const int WIDTH = 320;
+	static const int HEIGHT = 176;
+	static const int TILE_SIZE = 8;
+
+	OcclusionCuller() : m_depth(WIDTH * HEIGHT), m_tileDepth((WIDTH / TILE_SIZE) * (HEIGHT / TILE_SIZE)) {}
+
+	//starting a frame seen through viewProjection (with a vertical field of view in radians), forgetting last frame's
+	//occluders
+	void beginFrame(const glm::mat4& viewProjection, float fieldOfView)
+	{
+		m_viewProjection = viewProjection;
+		m_projectionScale = HEIGHT / (2.0f * std::tan(fieldOfView * 0.5f));
+		m_occluders.clear();
+	}
+
+	//buffer pixels one unit covers one unit of distance away, what occluder LODs get picked against
+	float projectionScale() const { return m_projectionScale; }
+
+	//an occluder's triangles (indices into vertices) placed with modelMatrix, the arrays have to live until rasterize()
+	void addOccluder(const glm::mat4& modelMatrix, const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+	{
+		if (indices.empty())
+			return;
+		Occluder occluder;
+		occluder.modelViewProjection = m_viewProjection * modelMatrix;
+		occluder.vertices = &vertices;
+		occluder.indices = &indices;
+		m_occluders.push_back(occluder);
+	}
+
+	//setting up every occluder's triangles and drawing them into the depth buffer
+	void rasterize()
+	{
+		ThreadPool& pool = ThreadPool::get();
+
+		//screen space triangles per occluder, set up in parallel
+		m_triangles.resize(m_occluders.size());
+		pool.parallelFor((unsigned int)m_occluders.size(), [this](unsigned int i) {
+			m_SetupTriangles(m_occluders[i], m_triangles[i]);
+		});
+
+		size_t triangleCount = 0;
+		for (unsigned int i = 0; i < m_triangles.size(); i++)
+			triangleCount += m_triangles[i].size();
+		FrameStats::get().frame.occluderTriangles += triangleCount;
+
+		//bands of whole tile rows, one per thread, so no two threads ever write the same pixels
+		const int tileRows = HEIGHT / TILE_SIZE;
+		int bands = std::min((int)pool.threadCount(), tileRows);
+		pool.parallelFor((unsigned int)bands, [this, bands, tileRows](unsigned int band) {
+			int firstRow = (int)band * tileRows / bands * TILE_SIZE;
+			int lastRow = ((int)band + 1) * tileRows / bands * TILE_SIZE;
+			m_RasterizeBand(firstRow, lastRow);
+		});
+	}
+
+	//world space boxes tested in parallel, visible[i] gets 0 when box i is completely behind the occluders
+	void testBoxes(const glm::vec3* minimums, const glm::vec3* maximums, size_t count, unsigned char* visible)
+	{
+		const unsigned int BOXES_PER_JOB = 256;
+		unsigned int jobs = (unsigned int)((count + BOXES_PER_JOB - 1) / BOXES_PER_JOB);
+		ThreadPool::get().parallelFor(jobs, [&](unsigned int job) {
+			size_t last = std::min(count, (size_t)(job + 1) * BOXES_PER_JOB);
+			for (size_t i = (size_t)job * BOXES_PER_JOB; i < last; i++)
+				visible[i] = m_BoxVisible(minimums[i], maximums[i]) ? 1 : 0;
+		});
+
+		unsigned int culled = 0;
+		for (size_t i = 0; i < count; i++)
+			culled += visible[i] ? 0 : 1;
+		FrameStats::get().frame.occlusionTested += count;
+		FrameStats::get().frame.occlusionCulled += culled;
+	}
+
+private:
+	static constexpr float NEAR_DISTANCE = 0.1f;		//clip w below which triangles are dropped and boxes kept
+
+	struct Occluder {
+		glm::mat4 modelViewProjection;
+		const std::vector<Vertex>* vertices;
+		const std::vector<unsigned int>* indices;
+	};
+
+	//counter clockwise in buffer pixels, with its pixel bounds and the depth it gets written at
+	struct ScreenTriangle {
+		float x[3], y[3];
+		float depth;
+		int minX, maxX, minY, maxY;		//inclusive
+	};
+
+	glm::mat4 m_viewProjection;
+	float m_projectionScale = 1.0f;
+	std::vector<Occluder> m_occluders;
+	std::vector<std::vector<ScreenTriangle> > m_triangles;		//per occluder, kept to not allocate every frame
+	std::vector<float> m_depth;
+	std::vector<float> m_tileDepth;		//furthest depth of each tile
+
+	void m_SetupTriangles(const Occluder& occluder, std::vector<ScreenTriangle>& triangles) const
+	{
+		triangles.clear();
+		const std::vector<Vertex>& vertices = *occluder.vertices;
+		const std::vector<unsigned int>& indices = *occluder.indices;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+			ScreenTriangle triangle;
+			bool clipped = false;
+			triangle.depth = 0.0f;
+			for (int corner = 0; corner < 3; corner++) {
+				glm::vec4 clip = occluder.modelViewProjection * glm::vec4(vertices[indices[i + corner]].position, 1.0f);
+				//dropping triangles reaching behind the near plane is the safe side, they only hide less
+				if (clip.w < NEAR_DISTANCE) {
+					clipped = true;
+					break;
+				}
+				triangle.x[corner] = (clip.x / clip.w * 0.5f + 0.5f) * WIDTH;
+				triangle.y[corner] = (clip.y / clip.w * 0.5f + 0.5f) * HEIGHT;
+				triangle.depth = std::max(triangle.depth, clip.w);
+			}
+			if (clipped)
+				continue;
+
+			//back facing and degenerate triangles do not add anything the front faces do not cover
+			float area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) - (triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+			if (area <= 0.0f)
+				continue;
+
+			triangle.minX = std::max((int)std::floor(std::min(std::min(triangle.x[0], triangle.x[1]), triangle.x[2])), 0);
+			triangle.maxX = std::min((int)std::ceil(std::max(std::max(triangle.x[0], triangle.x[1]), triangle.x[2])), WIDTH - 1);
+			triangle.minY = std::max((int)std::floor(std::min(std::min(triangle.y[0], triangle.y[1]), triangle.y[2])), 0);
+			triangle.maxY = std::min((int)std::ceil(std::max(std::max(triangle.y[0], triangle.y[1]), triangle.y[2])), HEIGHT - 1);
+			if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+				continue;
+			triangles.push_back(triangle);
+		}
+	}
+
+	//clearing rows [firstRow, lastRow), drawing every triangle overlapping them and updating their tiles
+	void m_RasterizeBand(int firstRow, int lastRow)
+	{
+		std::fill(m_depth.begin() + firstRow * WIDTH, m_depth.begin() + lastRow * WIDTH, INFINITY);
+
+		for (unsigned int o = 0; o < m_triangles.size(); o++) {
+			const std::vector<ScreenTriangle>& triangles = m_triangles[o];
+			for (unsigned int t = 0; t < triangles.size(); t++) {
+				const ScreenTriangle& triangle = triangles[t];
+				int minY = std::max(triangle.minY, firstRow), maxY = std::min(triangle.maxY, lastRow - 1);
+				if (minY <= maxY)
+					m_RasterizeTriangle(triangle, minY, maxY);
+			}
+		}
+
+		for (int tileY = firstRow / TILE_SIZE; tileY < lastRow / TILE_SIZE; tileY++) {
+			for (int tileX = 0; tileX < WIDTH / TILE_SIZE; tileX++) {
+				float furthest = 0.0f;
+				for (int y = tileY * TILE_SIZE; y < (tileY + 1) * TILE_SIZE; y++) {
+					const float* row = &m_depth[y * WIDTH + tileX * TILE_SIZE];
+					for (int x = 0; x < TILE_SIZE; x++)
+						furthest = std::max(furthest, row[x]);
+				}
+				m_tileDepth[tileY * (WIDTH / TILE_SIZE) + tileX] = furthest;
+			}
+		}
+	}
+
+	//edge functions at pixel centers, a pixel is covered when it is on the inner side of all three edges
+	void m_RasterizeTriangle(const ScreenTriangle& triangle, int minY, int maxY)
+	{
+		float edgeX[3], edgeY[3], edgeC[3];
+		for (int e = 0; e < 3; e++) {
+			int next = (e + 1) % 3;
+			//inside when (xb - xa) * (py - ya) - (yb - ya) * (px - xa) >= 0
+			edgeX[e] = -(triangle.y[next] - triangle.y[e]);
+			edgeY[e] = triangle.x[next] - triangle.x[e];
+			edgeC[e] = (triangle.y[next] - triangle.y[e]) * triangle.x[e] - (triangle.x[next] - triangle.x[e]) * triangle.y[e];
+		}
+
+		//starting on a multiple of 4 so the SSE loads and stores stay inside the row
+		int startX = triangle.minX & ~3;
+		for (int y = minY; y <= maxY; y++) {
+			float centerY = y + 0.5f;
+			float* row = &m_depth[y * WIDTH];
+#if defined(OCCLUSION_CULLER_SSE)
+			__m128 depth = _mm_set1_ps(triangle.depth);
+			__m128 zero = _mm_setzero_ps();
+			__m128 steps = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+			__m128 rowEdge[3], stepEdge[3];
+			for (int e = 0; e < 3; e++) {
+				rowEdge[e] = _mm_set1_ps(edgeY[e] * centerY + edgeC[e]);
+				stepEdge[e] = _mm_set1_ps(edgeX[e]);
+			}
+			for (int x = startX; x <= triangle.maxX; x += 4) {
+				__m128 centerX = _mm_add_ps(_mm_set1_ps((float)x), steps);
+				__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(stepEdge[0], centerX), rowEdge[0]), zero);
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(stepEdge[1], centerX), rowEdge[1]), zero));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(stepEdge[2], centerX), rowEdge[2]), zero));
+				if (_mm_movemask_ps(inside) == 0)
+					continue;
+				__m128 current = _mm_loadu_ps(row + x);
+				__m128 nearer = _mm_min_ps(current, depth);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, current)));
+			}
+#else
+			for (int x = startX; x <= triangle.maxX; x++) {
+				float centerX = x + 0.5f;
+				bool inside = true;
+				for (int e = 0; e < 3 && inside; e++)
+					inside = edgeX[e] * centerX + edgeY[e] * centerY + edgeC[e] >= 0.0f;
+				if (inside)
+					row[x] = std::min(row[x], triangle.depth);
+			}
+#endif
+		}
+	}
+
+	//hidden when every pixel the box's screen rectangle covers already has something closer than the box's nearest point
+	bool m_BoxVisible(const glm::vec3& minimum, const glm::vec3& maximum) const
+	{
+		float minX = INFINITY, maxX = -INFINITY, minY = INFINITY, maxY = -INFINITY, nearest = INFINITY;
+		for (int corner = 0; corner < 8; corner++) {
+			glm::vec3 point((corner & 1) ? maximum.x : minimum.x, (corner & 2) ? maximum.y : minimum.y, (corner & 4) ? maximum.z : minimum.z);
+			glm::vec4 clip = m_viewProjection * glm::vec4(point, 1.0f);
+			//reaching past the camera: nothing to compare against
+			if (clip.w < NEAR_DISTANCE)
+				return true;
+			float x = (clip.x / clip.w * 0.5f + 0.5f) * WIDTH;
+			float y = (clip.y / clip.w * 0.5f + 0.5f) * HEIGHT;
+			minX = std::min(minX, x);
+			maxX = std::max(maxX, x);
+			minY = std::min(minY, y);
+			maxY = std::max(maxY, y);
+			nearest = std::min(nearest, clip.w);
+		}
+
+		int x0 = std::max((int)std::floor(minX), 0), x1 = std::min((int)std::ceil(maxX), WIDTH - 1);
+		int y0 = std::max((int)std::floor(minY), 0), y1 = std::min((int)std::ceil(maxY), HEIGHT - 1);
+		if (x0 > x1 || y0 > y1)
+			return true;
+
+		for (int tileY = y0 / TILE_SIZE; tileY <= y1 / TILE_SIZE; tileY++) {
+			for (int tileX = x0 / TILE_SIZE; tileX <= x1 / TILE_SIZE; tileX++) {
+				if (m_tileDepth[tileY * (WIDTH / TILE_SIZE) + tileX] < nearest)
+					continue;
+
+				//the tile has something further than the box, looking at the covered pixels of it
+				int fromX = std::max(x0, tileX * TILE_SIZE), toX = std::min(x1, tileX * TILE_SIZE + TILE_SIZE - 1);
+				int fromY = std::max(y0, tileY * TILE_SIZE), toY = std::min(y1, tileY * TILE_SIZE + TILE_SIZE - 1);
+				for (int y = fromY; y <= toY; y++) {
+					const float* row = &m_depth[y * WIDTH];
+					for (int x = fromX; x <= toX; x++) {
+						if (row[x] >= nearest)
+							return true;
+					}
+				}
+			}
+		}
+		return false;
+	}
+};
+
+#endif
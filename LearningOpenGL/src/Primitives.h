@@ -0,0 +1,134 @@
+#pragma once
+#ifndef PRIMITIVES_H
+#define PRIMITIVES_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <vector>
+
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+
+//built in shapes as indexed meshes: every shape is written out as a plain triangle list, welded and then optimised
+//like an imported mesh, so it goes down the same indexed draw path as the models
+class Primitives {
+public:
+	//unit cube around the origin, every face mapping the whole texture
+	static Mesh cube(const std::vector<Texture>& textures, vertex_format format = VERTEX_FORMAT_FULL)
+	{
+		const glm::vec3 normals[6] = {
+			glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+			glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f),
+			glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)
+		};
+
+		std::vector<Vertex> vertices;
+		for (unsigned int i = 0; i < 6; i++) {
+			glm::vec3 normal = normals[i];
+			//u and v span the face so that cross(u, v) points outwards, which keeps the winding counter clockwise
+			glm::vec3 v = normal.y == 0.0f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(0.0f, 0.0f, -normal.y);
+			glm::vec3 u = glm::cross(v, normal);
+
+			Vertex corners[4];
+			for (unsigned int corner = 0; corner < 4; corner++) {
+				glm::vec2 uv((corner == 1 || corner == 2) ? 1.0f : 0.0f, corner >= 2 ? 1.0f : 0.0f);
+				corners[corner].position = (normal + (uv.x * 2.0f - 1.0f) * u + (uv.y * 2.0f - 1.0f) * v) * 0.5f;
+				corners[corner].normal = normal;
+				corners[corner].texture = uv;
+			}
+			m_AddQuad(vertices, corners[0], corners[1], corners[2], corners[3]);
+		}
+		return m_Finish(vertices, textures, format);
+	}
+
+	//sphere of radius 0.5 with u going around the equator and v from the south to the north pole
+	static Mesh sphere(const std::vector<Texture>& textures, unsigned int segments = 32, unsigned int rings = 16, vertex_format format = VERTEX_FORMAT_FULL)
+	{
+		std::vector<Vertex> vertices;
+		for (unsigned int ring = 0; ring < rings; ring++) {
+			for (unsigned int segment = 0; segment < segments; segment++) {
+				Vertex a = m_SphereVertex(segment, ring, segments, rings);
+				Vertex b = m_SphereVertex(segment + 1, ring, segments, rings);
+				Vertex c = m_SphereVertex(segment + 1, ring + 1, segments, rings);
+				Vertex d = m_SphereVertex(segment, ring + 1, segments, rings);
+
+				//the quads touching a pole lose their zero area half
+				if (ring != 0)
+					m_AddTriangle(vertices, a, b, c);
+				if (ring != rings - 1)
+					m_AddTriangle(vertices, a, c, d);
+			}
+		}
+		return m_Finish(vertices, textures, format);
+	}
+
+	//size x size square in the XZ plane facing up, split into subdivisions x subdivisions quads
+	static Mesh plane(const std::vector<Texture>& textures, float size = 1.0f, unsigned int subdivisions = 1, vertex_format format = VERTEX_FORMAT_FULL)
+	{
+		std::vector<Vertex> vertices;
+		for (unsigned int z = 0; z < subdivisions; z++) {
+			for (unsigned int x = 0; x < subdivisions; x++) {
+				Vertex a = m_PlaneVertex(x, z + 1, size, subdivisions);
+				Vertex b = m_PlaneVertex(x + 1, z + 1, size, subdivisions);
+				Vertex c = m_PlaneVertex(x + 1, z, size, subdivisions);
+				Vertex d = m_PlaneVertex(x, z, size, subdivisions);
+				m_AddQuad(vertices, a, b, c, d);
+			}
+		}
+		return m_Finish(vertices, textures, format);
+	}
+
+private:
+	static void m_AddTriangle(std::vector<Vertex>& vertices, const Vertex& a, const Vertex& b, const Vertex& c)
+	{
+		vertices.push_back(a);
+		vertices.push_back(b);
+		vertices.push_back(c);
+	}
+
+	//counter clockwise a, b, c, d
+	static void m_AddQuad(std::vector<Vertex>& vertices, const Vertex& a, const Vertex& b, const Vertex& c, const Vertex& d)
+	{
+		m_AddTriangle(vertices, a, b, c);
+		m_AddTriangle(vertices, a, c, d);
+	}
+
+	static Vertex m_SphereVertex(unsigned int segment, unsigned int ring, unsigned int segments, unsigned int rings)
+	{
+		float u = (float)segment / segments;
+		float v = (float)ring / rings;
+		float azimuth = u * glm::two_pi<float>();
+		float polar = v * glm::pi<float>();
+
+		//the last column repeats the first with u = 1, so its position has to match bit for bit
+		if (segment == segments)
+			azimuth = 0.0f;
+
+		Vertex vertex;
+		vertex.normal = glm::vec3(glm::sin(polar) * glm::cos(azimuth), -glm::cos(polar), -glm::sin(polar) * glm::sin(azimuth));
+		vertex.position = vertex.normal * 0.5f;
+		vertex.texture = glm::vec2(u, v);
+		return vertex;
+	}
+
+	static Vertex m_PlaneVertex(unsigned int x, unsigned int z, float size, unsigned int subdivisions)
+	{
+		glm::vec2 uv((float)x / subdivisions, 1.0f - (float)z / subdivisions);
+		Vertex vertex;
+		vertex.position = glm::vec3((uv.x - 0.5f) * size, 0.0f, (0.5f - uv.y) * size);
+		vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+		vertex.texture = uv;
+		return vertex;
+	}
+
+	static Mesh m_Finish(std::vector<Vertex>& vertices, const std::vector<Texture>& textures, vertex_format format)
+	{
+		std::vector<unsigned int> indices;
+		MeshOptimizer::weldVertices(vertices, indices);
+		MeshOptimizer::optimize(vertices, indices);
+		return Mesh(vertices, indices, textures, format);
+	}
+};
+
+#endif
@@ -0,0 +1,501 @@
+#pragma once
+#ifndef SCENE_BVH_H
+#define SCENE_BVH_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include "Frustum.h"
+#include "CullBatch.h"
+#include "FrameStats.h"
+
+//world space box of model space bounds (box center + half extents) under a model matrix
+inline void worldBounds(const glm::mat4& modelMatrix, const glm::vec3& center, const glm::vec3& extents, glm::vec3& minimum, glm::vec3& maximum)
+{
+	glm::vec3 worldCenter = glm::vec3(modelMatrix * glm::vec4(center, 1.0f));
+	glm::mat3 absolute = glm::mat3(glm::abs(glm::vec3(modelMatrix[0])), glm::abs(glm::vec3(modelMatrix[1])), glm::abs(glm::vec3(modelMatrix[2])));
+	glm::vec3 worldExtents = absolute * extents;
+	minimum = worldCenter - worldExtents;
+	maximum = worldCenter + worldExtents;
+}
+
+//dynamic bounding volume hierarchy over the scene's objects. objects are leaves holding a world space box and a user
+//value, they get inserted where they grow the tree's surface area the least and moving them only refits the boxes
+//above them, so culling and spatial queries visit a few nodes per hit instead of every object.
+//rebuild() builds the whole tree again top down with a binned SAH, for after many inserts or when objects moved far
+class SceneBVH {
+public:
+	static const unsigned int NONE = 0xFFFFFFFF;
+
+	//returns the proxy the object is updated and removed with
+	unsigned int insert(const glm::vec3& minimum, const glm::vec3& maximum, unsigned int userData)
+	{
+		unsigned int leaf = m_AllocateNode();
+		m_nodes[leaf].minimum = minimum;
+		m_nodes[leaf].maximum = maximum;
+		m_nodes[leaf].userData = userData;
+		m_InsertLeaf(leaf);
+		m_leafCount++;
+		return leaf;
+	}
+
+	void remove(unsigned int proxy)
+	{
+		m_RemoveLeaf(proxy);
+		m_FreeNode(proxy);
+		m_leafCount--;
+	}
+
+	void clear()
+	{
+		m_nodes.clear();
+		m_free.clear();
+		m_dirty.clear();
+		m_root = NONE;
+		m_leafCount = 0;
+	}
+
+	//giving a leaf its new box, the nodes above it catch up on the next refit
+	void update(unsigned int proxy, const glm::vec3& minimum, const glm::vec3& maximum)
+	{
+		m_nodes[proxy].minimum = minimum;
+		m_nodes[proxy].maximum = maximum;
+		m_dirty.push_back(proxy);
+	}
+
+	//growing and shrinking the ancestors of every updated leaf, stopping where a box does not change
+	void refit()
+	{
+		for (unsigned int i = 0; i < m_dirty.size(); i++) {
+			unsigned int node = m_nodes[m_dirty[i]].parent;
+			while (node != NONE) {
+				if (!m_Refit(node))
+					break;
+				node = m_nodes[node].parent;
+			}
+		}
+		m_dirty.clear();
+	}
+
+	//top down binned SAH build over the current leaves, keeping their proxies
+	void rebuild()
+	{
+		std::vector<unsigned int> leaves;
+		for (unsigned int i = 0; i < m_nodes.size(); i++) {
+			if (m_nodes[i].live && m_nodes[i].left == NONE)
+				leaves.push_back(i);
+			else if (m_nodes[i].live)
+				m_FreeNode(i);
+		}
+		m_dirty.clear();
+		m_root = leaves.empty() ? NONE : m_Build(leaves, 0, (unsigned int)leaves.size());
+		if (m_root != NONE)
+			m_nodes[m_root].parent = NONE;
+	}
+
+	size_t size() const { return m_leafCount; }
+
+	//the box a leaf was last given
+	void bounds(unsigned int proxy, glm::vec3& minimum, glm::vec3& maximum) const
+	{
+		minimum = m_nodes[proxy].minimum;
+		maximum = m_nodes[proxy].maximum;
+	}
+
+	//user values of every leaf whose box is at least partly inside the frustum. subtrees completely inside are taken
+	//without testing their leaves, the leaves of partly inside nodes are tested together by the SIMD kernel
+	void queryFrustum(const Frustum& frustum, std::vector<unsigned int>& results)
+	{
+		if (m_root == NONE)
+			return;
+
+		m_candidates.clear();
+		m_stack.clear();
+		m_stack.push_back(StackEntry(m_root, 0));
+		unsigned int visited = 0;
+		while (!m_stack.empty()) {
+			StackEntry entry = m_stack.back();
+			m_stack.pop_back();
+			const Node& node = m_nodes[entry.node];
+			visited++;
+
+			if (node.left == NONE) {
+				if (entry.insidePlanes == ALL_PLANES)
+					results.push_back(node.userData);
+				else
+					m_candidates.push_back(entry.node);
+				continue;
+			}
+
+			//skipping the planes a parent was already completely inside of
+			unsigned int insidePlanes = entry.insidePlanes;
+			bool outside = false;
+			if (insidePlanes != ALL_PLANES) {
+				glm::vec3 center = (node.minimum + node.maximum) * 0.5f;
+				glm::vec3 extents = (node.maximum - node.minimum) * 0.5f;
+				for (int p = 0; p < 6 && !outside; p++) {
+					if (insidePlanes & (1u << p))
+						continue;
+					const glm::vec4& plane = frustum.planes[p];
+					float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+					float reach = glm::dot(glm::abs(glm::vec3(plane)), extents);
+					if (distance < -reach)
+						outside = true;
+					else if (distance >= reach)
+						insidePlanes |= 1u << p;
+				}
+			}
+			if (outside)
+				continue;
+			m_stack.push_back(StackEntry(node.left, insidePlanes));
+			m_stack.push_back(StackEntry(node.right, insidePlanes));
+		}
+
+		m_leafCulling.clear();
+		for (unsigned int i = 0; i < m_candidates.size(); i++) {
+			const Node& leaf = m_nodes[m_candidates[i]];
+			glm::vec3 extents = (leaf.maximum - leaf.minimum) * 0.5f;
+			m_leafCulling.addWorld((leaf.minimum + leaf.maximum) * 0.5f, extents, glm::length(extents));
+		}
+		m_leafCulling.cull(frustum);
+		for (unsigned int i = 0; i < m_candidates.size(); i++) {
+			if (m_leafCulling.visible(i))
+				results.push_back(m_nodes[m_candidates[i]].userData);
+		}
+		FrameStats::get().frame.bvhNodesVisited += visited;
+	}
+
+	//user values of every leaf whose box touches the sphere
+	void querySphere(const glm::vec3& center, float radius, std::vector<unsigned int>& results)
+	{
+		if (m_root == NONE)
+			return;
+
+		m_stack.clear();
+		m_stack.push_back(StackEntry(m_root, 0));
+		while (!m_stack.empty()) {
+			const Node& node = m_nodes[m_stack.back().node];
+			m_stack.pop_back();
+
+			glm::vec3 closest = glm::clamp(center, node.minimum, node.maximum);
+			glm::vec3 offset = closest - center;
+			if (glm::dot(offset, offset) > radius * radius)
+				continue;
+
+			if (node.left == NONE) {
+				results.push_back(node.userData);
+				continue;
+			}
+			m_stack.push_back(StackEntry(node.left, 0));
+			m_stack.push_back(StackEntry(node.right, 0));
+		}
+	}
+
+	//user values of every leaf whose box the ray enters before maxDistance, nearest entry first
+	void queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<unsigned int>& results)
+	{
+		if (m_root == NONE)
+			return;
+
+		glm::vec3 inverse = 1.0f / direction;
+		m_rayHits.clear();
+		m_stack.clear();
+		m_stack.push_back(StackEntry(m_root, 0));
+		while (!m_stack.empty()) {
+			const Node& node = m_nodes[m_stack.back().node];
+			m_stack.pop_back();
+
+			float entry;
+			if (!m_RayBox(origin, inverse, node.minimum, node.maximum, maxDistance, entry))
+				continue;
+
+			if (node.left == NONE) {
+				m_rayHits.push_back(std::make_pair(entry, node.userData));
+				continue;
+			}
+			m_stack.push_back(StackEntry(node.left, 0));
+			m_stack.push_back(StackEntry(node.right, 0));
+		}
+
+		std::sort(m_rayHits.begin(), m_rayHits.end());
+		for (unsigned int i = 0; i < m_rayHits.size(); i++)
+			results.push_back(m_rayHits[i].second);
+	}
+
+	//surface area heuristic cost of the tree relative to its root, lower is better
+	float cost() const
+	{
+		if (m_root == NONE)
+			return 0.0f;
+		float total = 0.0f;
+		for (unsigned int i = 0; i < m_nodes.size(); i++) {
+			if (m_nodes[i].live && m_nodes[i].left != NONE)
+				total += m_Area(m_nodes[i].minimum, m_nodes[i].maximum);
+		}
+		float rootArea = m_Area(m_nodes[m_root].minimum, m_nodes[m_root].maximum);
+		return rootArea > 0.0f ? total / rootArea : 0.0f;
+	}
+
+private:
+	static const unsigned int ALL_PLANES = 0x3F;
+	static const unsigned int SAH_BINS = 12;
+
+	struct Node {
+		glm::vec3 minimum, maximum;
+		unsigned int parent = NONE;
+		unsigned int left = NONE;		//NONE for leaves
+		unsigned int right = NONE;
+		unsigned int userData = 0;
+		bool live = false;
+	};
+
+	struct StackEntry {
+		unsigned int node;
+		unsigned int insidePlanes;		//bits of the frustum planes the node is known to be completely inside of
+		StackEntry(unsigned int node, unsigned int insidePlanes) : node(node), insidePlanes(insidePlanes) {}
+	};
+
+	std::vector<Node> m_nodes;
+	std::vector<unsigned int> m_free;
+	std::vector<unsigned int> m_dirty;
+	unsigned int m_root = NONE;
+	size_t m_leafCount = 0;
+
+	//query scratch, kept to not allocate every frame
+	std::vector<StackEntry> m_stack;
+	std::vector<unsigned int> m_candidates;
+	std::vector<std::pair<float, unsigned int> > m_rayHits;		//leaves hit with their entry distance
+	CullBatch m_leafCulling;
+
+	static float m_Area(const glm::vec3& minimum, const glm::vec3& maximum)
+	{
+		glm::vec3 size = maximum - minimum;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	unsigned int m_AllocateNode()
+	{
+		unsigned int node;
+		if (!m_free.empty()) {
+			node = m_free.back();
+			m_free.pop_back();
+		}
+		else {
+			node = (unsigned int)m_nodes.size();
+			m_nodes.push_back(Node());
+		}
+		m_nodes[node] = Node();
+		m_nodes[node].live = true;
+		return node;
+	}
+
+	void m_FreeNode(unsigned int node)
+	{
+		m_nodes[node].live = false;
+		m_free.push_back(node);
+	}
+
+	//recomputing an internal node's box from its children, returns whether it changed
+	bool m_Refit(unsigned int index)
+	{
+		Node& node = m_nodes[index];
+		glm::vec3 minimum = glm::min(m_nodes[node.left].minimum, m_nodes[node.right].minimum);
+		glm::vec3 maximum = glm::max(m_nodes[node.left].maximum, m_nodes[node.right].maximum);
+		if (minimum == node.minimum && maximum == node.maximum)
+			return false;
+		node.minimum = minimum;
+		node.maximum = maximum;
+		return true;
+	}
+
+	//walking down towards the cheapest sibling (the branch and bound of Box2D's dynamic tree, greedy version)
+	void m_InsertLeaf(unsigned int leaf)
+	{
+		if (m_root == NONE) {
+			m_root = leaf;
+			m_nodes[leaf].parent = NONE;
+			return;
+		}
+
+		glm::vec3 leafMin = m_nodes[leaf].minimum, leafMax = m_nodes[leaf].maximum;
+		unsigned int sibling = m_root;
+		while (m_nodes[sibling].left != NONE) {
+			const Node& node = m_nodes[sibling];
+			float area = m_Area(node.minimum, node.maximum);
+			float combinedArea = m_Area(glm::min(node.minimum, leafMin), glm::max(node.maximum, leafMax));
+
+			//pairing with this node versus pushing the leaf further down, which grows this node anyway
+			float pairCost = 2.0f * combinedArea;
+			float inheritedCost = 2.0f * (combinedArea - area);
+			float leftCost = m_DescendCost(node.left, leafMin, leafMax) + inheritedCost;
+			float rightCost = m_DescendCost(node.right, leafMin, leafMax) + inheritedCost;
+			if (pairCost < leftCost && pairCost < rightCost)
+				break;
+			sibling = leftCost < rightCost ? node.left : node.right;
+		}
+
+		//a new parent takes the sibling's place with the sibling and the leaf below it
+		unsigned int oldParent = m_nodes[sibling].parent;
+		unsigned int parent = m_AllocateNode();
+		m_nodes[parent].parent = oldParent;
+		m_nodes[parent].left = sibling;
+		m_nodes[parent].right = leaf;
+		m_nodes[parent].minimum = glm::min(m_nodes[sibling].minimum, leafMin);
+		m_nodes[parent].maximum = glm::max(m_nodes[sibling].maximum, leafMax);
+		m_nodes[sibling].parent = parent;
+		m_nodes[leaf].parent = parent;
+
+		if (oldParent == NONE) {
+			m_root = parent;
+		}
+		else {
+			if (m_nodes[oldParent].left == sibling)
+				m_nodes[oldParent].left = parent;
+			else
+				m_nodes[oldParent].right = parent;
+			for (unsigned int node = oldParent; node != NONE && m_Refit(node); node = m_nodes[node].parent) {}
+		}
+	}
+
+	float m_DescendCost(unsigned int child, const glm::vec3& leafMin, const glm::vec3& leafMax) const
+	{
+		const Node& node = m_nodes[child];
+		float combinedArea = m_Area(glm::min(node.minimum, leafMin), glm::max(node.maximum, leafMax));
+		if (node.left == NONE)
+			return combinedArea;
+		return combinedArea - m_Area(node.minimum, node.maximum);
+	}
+
+	//the leaf's sibling takes the place of their parent
+	void m_RemoveLeaf(unsigned int leaf)
+	{
+		if (leaf == m_root) {
+			m_root = NONE;
+			return;
+		}
+
+		unsigned int parent = m_nodes[leaf].parent;
+		unsigned int grandParent = m_nodes[parent].parent;
+		unsigned int sibling = m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left;
+		m_FreeNode(parent);
+
+		m_nodes[sibling].parent = grandParent;
+		if (grandParent == NONE) {
+			m_root = sibling;
+			return;
+		}
+		if (m_nodes[grandParent].left == parent)
+			m_nodes[grandParent].left = sibling;
+		else
+			m_nodes[grandParent].right = sibling;
+		for (unsigned int node = grandParent; node != NONE && m_Refit(node); node = m_nodes[node].parent) {}
+	}
+
+	//splitting leaves[first, last) along the axis and bin boundary with the lowest surface area cost
+	unsigned int m_Build(std::vector<unsigned int>& leaves, unsigned int first, unsigned int last)
+	{
+		if (last - first == 1)
+			return leaves[first];
+
+		glm::vec3 centroidMin(1e30f), centroidMax(-1e30f);
+		for (unsigned int i = first; i < last; i++) {
+			glm::vec3 centroid = (m_nodes[leaves[i]].minimum + m_nodes[leaves[i]].maximum) * 0.5f;
+			centroidMin = glm::min(centroidMin, centroid);
+			centroidMax = glm::max(centroidMax, centroid);
+		}
+
+		int bestAxis = -1;
+		unsigned int bestBin = 0;
+		float bestCost = 1e30f;
+		for (int axis = 0; axis < 3; axis++) {
+			float extent = centroidMax[axis] - centroidMin[axis];
+			if (extent <= 0.0f)
+				continue;
+
+			glm::vec3 binMin[SAH_BINS], binMax[SAH_BINS];
+			unsigned int binCount[SAH_BINS] = {};
+			for (unsigned int b = 0; b < SAH_BINS; b++) {
+				binMin[b] = glm::vec3(1e30f);
+				binMax[b] = glm::vec3(-1e30f);
+			}
+			for (unsigned int i = first; i < last; i++) {
+				const Node& leaf = m_nodes[leaves[i]];
+				unsigned int b = m_Bin((leaf.minimum[axis] + leaf.maximum[axis]) * 0.5f, centroidMin[axis], extent);
+				binMin[b] = glm::min(binMin[b], leaf.minimum);
+				binMax[b] = glm::max(binMax[b], leaf.maximum);
+				binCount[b]++;
+			}
+
+			//sweeping from the right first, then from the left evaluating every boundary
+			float rightArea[SAH_BINS];
+			unsigned int rightCount[SAH_BINS];
+			glm::vec3 sweepMin(1e30f), sweepMax(-1e30f);
+			unsigned int count = 0;
+			for (unsigned int b = SAH_BINS - 1; b > 0; b--) {
+				sweepMin = glm::min(sweepMin, binMin[b]);
+				sweepMax = glm::max(sweepMax, binMax[b]);
+				count += binCount[b];
+				rightArea[b] = count ? m_Area(sweepMin, sweepMax) : 0.0f;
+				rightCount[b] = count;
+			}
+			sweepMin = glm::vec3(1e30f);
+			sweepMax = glm::vec3(-1e30f);
+			count = 0;
+			for (unsigned int b = 0; b < SAH_BINS - 1; b++) {
+				sweepMin = glm::min(sweepMin, binMin[b]);
+				sweepMax = glm::max(sweepMax, binMax[b]);
+				count += binCount[b];
+				if (count == 0 || rightCount[b + 1] == 0)
+					continue;
+				float cost = count * m_Area(sweepMin, sweepMax) + rightCount[b + 1] * rightArea[b + 1];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = b;
+				}
+			}
+		}
+
+		//every centroid in one spot: any split is as good as another
+		unsigned int middle = first + (last - first) / 2;
+		if (bestAxis != -1) {
+			float extent = centroidMax[bestAxis] - centroidMin[bestAxis];
+			std::vector<unsigned int>::iterator split = std::partition(leaves.begin() + first, leaves.begin() + last, [&](unsigned int leaf) {
+				return m_Bin((m_nodes[leaf].minimum[bestAxis] + m_nodes[leaf].maximum[bestAxis]) * 0.5f, centroidMin[bestAxis], extent) <= bestBin;
+			});
+			middle = (unsigned int)(split - leaves.begin());
+		}
+
+		unsigned int left = m_Build(leaves, first, middle);
+		unsigned int right = m_Build(leaves, middle, last);
+		unsigned int node = m_AllocateNode();
+		m_nodes[node].left = left;
+		m_nodes[node].right = right;
+		m_nodes[node].minimum = glm::min(m_nodes[left].minimum, m_nodes[right].minimum);
+		m_nodes[node].maximum = glm::max(m_nodes[left].maximum, m_nodes[right].maximum);
+		m_nodes[left].parent = node;
+		m_nodes[right].parent = node;
+		return node;
+	}
+
+	static unsigned int m_Bin(float centroid, float minimum, float extent)
+	{
+		unsigned int bin = (unsigned int)((centroid - minimum) / extent * SAH_BINS);
+		return bin < SAH_BINS ? bin : SAH_BINS - 1;
+	}
+
+	//slab test, entry is where the ray enters the box (0 when it starts inside)
+	static bool m_RayBox(const glm::vec3& origin, const glm::vec3& inverse, const glm::vec3& minimum, const glm::vec3& maximum, float maxDistance, float& entry)
+	{
+		glm::vec3 t0 = (minimum - origin) * inverse;
+		glm::vec3 t1 = (maximum - origin) * inverse;
+		glm::vec3 near = glm::min(t0, t1), far = glm::max(t0, t1);
+		entry = glm::max(glm::max(glm::max(near.x, near.y), near.z), 0.0f);
+		float exit = glm::min(glm::min(glm::min(far.x, far.y), far.z), maxDistance);
+		return entry <= exit;
+	}
+};
+
+#endif
@@ -8,18 +8,32 @@
 #include <fstream>		//file stream
 #include <sstream>		//string stream
 #include <string>
+#include <vector>
+#include <cstring>
+#include <filesystem>
+#include <unordered_map>
+
+#include "FrameStats.h"
+#include "GLState.h"
+#include "UniformBuffer.h"
+
+//GL_KHR_parallel_shader_compile is not part of the generated glad loader, so it gets loaded by hand
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
 
 class Shader 
 {
 public:
 	unsigned int programID;		//program ID
 
-	//constructor that reads and builds the shader
-	Shader(const char* vertexPath, const char* fragmentPath) 
+	//constructor that reads the shader and submits it to the driver without waiting for the result,
+	//constructing several shaders back to back therefore submits the whole batch before anything blocks
+	//(the optional defines are lines like "#define NAME VALUE\n" that get injected after the #version line)
+	Shader(const char* vertexPath, const char* fragmentPath, const std::string& vertexDefines = "", const std::string& fragmentDefines = "") 
 	{
 		//1. retrieving the vertex + fragment source codes
-		std::string vertexCode;
-		std::string fragmentCode;
 		std::ifstream vShaderFile;
 		std::ifstream fShaderFile;
 
@@ -43,114 +57,645 @@ public:
 			fShaderFile.close();
 
 			//d. converting the stream into a string
-			vertexCode = vShaderStream.str();
-			fragmentCode = fShaderStream.str();
+			m_vertexCode = m_InjectDefines(vShaderStream.str(), vertexDefines);
+			m_fragmentCode = m_InjectDefines(fShaderStream.str(), fragmentDefines);
 		}
 		catch (std::ifstream::failure error) 
 		{
 			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
 		}
-		const char* vShaderCode = vertexCode.c_str();
-		const char* fShaderCode = fragmentCode.c_str();
-
-		//2. compiling shaders
-		unsigned int vertex, fragment;
-		
-		//vertex shader compilation
-		vertex = glCreateShader(GL_VERTEX_SHADER);
-		glShaderSource(vertex, 1, &vShaderCode, NULL);
-		glCompileShader(vertex);
-		m_checkCompileErrors(vertex, "VERTEX");
-
-		//fragment shader compilation
-		fragment = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(fragment, 1, &fShaderCode, NULL);
-		glCompileShader(fragment);
-		m_checkCompileErrors(fragment, "FRAGMENT");
-
-		//creating the shader program
+		buildStats().programsBuilt++;
+
+		//2. trying the program binary cache first, skipping compilation entirely if it is still valid
 		programID = glCreateProgram();
-		glAttachShader(programID, vertex);
-		glAttachShader(programID, fragment);
-		glLinkProgram(programID);
-		m_checkCompileErrors(programID, "PROGRAM");
+		m_cacheKey = m_ProgramCacheKey(m_vertexCode, m_fragmentCode);
+		m_pending = true;
+		if (m_LoadProgramBinary(m_cacheKey)) {
+			m_fromBinary = true;
+			return;
+		}
 
-		//deleting unused shaders since they are linked to program
-		glDeleteShader(vertex);
-		glDeleteShader(fragment);
+		//3. compiling + linking, the results only get checked once the program is first used
+		m_SubmitCompile();
 	}
 
-	//using + activating the shader
+	//using + activating the shader (waits for the program to finish linking the first time)
 	void useProgram()
 	{
-		glUseProgram(programID);
+		m_Finalize();
+		GLState::useProgram(programID);
+	}
+
+	//non-blocking check, with GL_KHR_parallel_shader_compile this lets the render loop skip programs that are still compiling
+	bool isReady()
+	{
+		if (!m_pending)
+			return true;
+
+		//without the extension there is no way to ask, so finishing the program here is the best we can do
+		if (parallelCompileSupported()) {
+			int completed = 0;
+			glGetProgramiv(programID, GL_COMPLETION_STATUS_KHR, &completed);
+			if (!completed)
+				return false;
+		}
+		m_Finalize();
+		return true;
+	}
+
+	//asks the driver for background compiler threads, must be called after glad is loaded and before creating shaders
+	static void EnableParallelCompile(GLADloadproc loader)
+	{
+		int extensionCount = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+
+		PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxCompilerThreads = NULL;
+		for (int i = 0; i < extensionCount && !maxCompilerThreads; i++) {
+			const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+			if (std::strcmp(extension, "GL_KHR_parallel_shader_compile") == 0)
+				maxCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)loader("glMaxShaderCompilerThreadsKHR");
+			else if (std::strcmp(extension, "GL_ARB_parallel_shader_compile") == 0)
+				maxCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)loader("glMaxShaderCompilerThreadsARB");
+		}
+
+		if (maxCompilerThreads) {
+			maxCompilerThreads(0xFFFFFFFF);			//letting the driver pick how many threads to use
+			parallelCompileSupported() = true;
+		}
+		std::cout << "PARALLEL SHADER COMPILE " << (parallelCompileSupported() ? "ENABLED!" : "NOT SUPPORTED!") << std::endl;
+	}
+
+	static bool& parallelCompileSupported()
+	{
+		static bool s_supported = false;
+		return s_supported;
+	}
+
+	//counters describing how the programs were built during startup
+	struct BuildStats {
+		unsigned int programsBuilt = 0;
+		unsigned int binaryCacheHits = 0;
+		unsigned int stagesCompiled = 0;
+		unsigned int compilesAvoided = 0;		//stages reused from the stage cache
+	};
+	static BuildStats& buildStats()
+	{
+		static BuildStats s_stats;
+		return s_stats;
+	}
+
+	//folder the linked program binaries get cached in (relative to the working directory)
+	static std::string& binaryCacheDirectory()
+	{
+		static std::string s_directory = "cache/shaders";
+		return s_directory;
+	}
+
+	//benchmark switch: when true the setters fall back to calling glGetUniformLocation every time (toggled with L)
+	static bool& legacyUniformLookup()
+	{
+		static bool s_legacy = false;
+		return s_legacy;
+	}
+
+	//returns the location of a uniform, or -1 if the program has no active uniform with that name
+	int getUniformLocation(const char* name) const
+	{
+		//the program is logically const, finishing a pending link is just an implementation detail
+		const_cast<Shader*>(this)->m_Finalize();
+
+		if (legacyUniformLookup()) {
+			FrameStats::get().frame.locationQueries++;
+			return glGetUniformLocation(programID, name);
+		}
+
+		int slot = m_FindSlot(name);
+		return slot == -1 ? -1 : m_uniformSlots[slot].location;
 	}
 
 	//utilities for the uniform (just need to specify the name of the uniform variable, and the value they get set)
-	void setBool(const std::string &name, bool value) const
+	//every setter compares against the shadow copy first and skips the driver call when nothing changed
+	void setBool(const char* name, bool value) const
 	{
-		glUniform1i(glGetUniformLocation(programID, name.c_str()), (int)value);
+		setInt(name, (int)value);
 	}
-	void setInt(const std::string &name, int value) const
+	void setInt(const char* name, int value) const
 	{
-		glUniform1i(glGetUniformLocation(programID, name.c_str()), value);
+		int location = m_PrepareUpload(name, &value, sizeof(value));
+		if (location != -1)
+			glUniform1i(location, value);
 	}
-	void setFloat(const std::string &name, float value) const
+	void setFloat(const char* name, float value) const
 	{
-		glUniform1f(glGetUniformLocation(programID, name.c_str()), value);
+		int location = m_PrepareUpload(name, &value, sizeof(value));
+		if (location != -1)
+			glUniform1f(location, value);
+	}
 
+	void setIVec4(const char* name, const glm::ivec4 &value) const
+	{
+		int location = m_PrepareUpload(name, &value[0], sizeof(value));
+		if (location != -1)
+			glUniform4iv(location, 1, &value[0]);
 	}
 
 	//functions for setting vectors in uniforms
-	void setVec2(const std::string &name, const glm::vec2 &value) const
+	void setVec2(const char* name, const glm::vec2 &value) const
 	{
-		glUniform2fv(glGetUniformLocation(programID, name.c_str()), 1, &value[0]);
+		int location = m_PrepareUpload(name, &value[0], sizeof(value));
+		if (location != -1)
+			glUniform2fv(location, 1, &value[0]);
 	}
 	//for setting specifically an x and y
-	void setVec2(const std::string &name, float x, float y) const
+	void setVec2(const char* name, float x, float y) const
 	{
-		glUniform2f(glGetUniformLocation(programID, name.c_str()), x, y);
+		setVec2(name, glm::vec2(x, y));
 	}
 
 	//setting vector 3
-	void setVec3(const std::string &name, const glm::vec3 &value) const
+	void setVec3(const char* name, const glm::vec3 &value) const
 	{
-		glUniform3fv(glGetUniformLocation(programID, name.c_str()), 1, &value[0]);
+		int location = m_PrepareUpload(name, &value[0], sizeof(value));
+		if (location != -1)
+			glUniform3fv(location, 1, &value[0]);
 	}
-	//for setting specifically an x and y
-	void setVec3(const std::string &name, float x, float y, float z) const
+	//for setting specifically an x, y and z
+	void setVec3(const char* name, float x, float y, float z) const
 	{
-		glUniform3f(glGetUniformLocation(programID, name.c_str()), x, y, z);
+		setVec3(name, glm::vec3(x, y, z));
 	}
 
 	//setting vector 4
-	void setVec4(const std::string &name, const glm::vec4 &value) const
+	void setVec4(const char* name, const glm::vec4 &value) const
 	{
-		glUniform4fv(glGetUniformLocation(programID, name.c_str()), 1, &value[0]);
+		int location = m_PrepareUpload(name, &value[0], sizeof(value));
+		if (location != -1)
+			glUniform4fv(location, 1, &value[0]);
 	}
-	//for setting specifically an x and y
-	void setVec4(const std::string &name, float x, float y, float z, float w) const
+	//for setting specifically an x, y, z and w
+	void setVec4(const char* name, float x, float y, float z, float w) const
 	{
-		glUniform4f(glGetUniformLocation(programID, name.c_str()), x, y, z, w);
+		setVec4(name, glm::vec4(x, y, z, w));
 	}
 
 	//functions for setting matrixes
-	void setMat2(const std::string &name, const glm::mat2 &matrix) const
+	void setMat2(const char* name, const glm::mat2 &matrix) const
 	{
-		glUniformMatrix2fv(glGetUniformLocation(programID, name.c_str()), 1, GL_FALSE, &matrix[0][0]);
+		int location = m_PrepareUpload(name, &matrix[0][0], sizeof(matrix));
+		if (location != -1)
+			glUniformMatrix2fv(location, 1, GL_FALSE, &matrix[0][0]);
 	}
-	void setMat3(const std::string &name, const glm::mat3 &matrix) const
+	void setMat3(const char* name, const glm::mat3 &matrix) const
 	{
-		glUniformMatrix3fv(glGetUniformLocation(programID, name.c_str()), 1, GL_FALSE, &matrix[0][0]);
+		int location = m_PrepareUpload(name, &matrix[0][0], sizeof(matrix));
+		if (location != -1)
+			glUniformMatrix3fv(location, 1, GL_FALSE, &matrix[0][0]);
 	}
-	void setMat4(const std::string &name, const glm::mat4 &matrix) const
+	void setMat4(const char* name, const glm::mat4 &matrix) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(programID, name.c_str()), 1, GL_FALSE, &matrix[0][0]);
+		int location = m_PrepareUpload(name, &matrix[0][0], sizeof(matrix));
+		if (location != -1)
+			glUniformMatrix4fv(location, 1, GL_FALSE, &matrix[0][0]);
 	}
 
+	//std::string overloads for names that are built at runtime
+	void setBool(const std::string &name, bool value) const { setBool(name.c_str(), value); }
+	void setInt(const std::string &name, int value) const { setInt(name.c_str(), value); }
+	void setFloat(const std::string &name, float value) const { setFloat(name.c_str(), value); }
+	void setVec2(const std::string &name, const glm::vec2 &value) const { setVec2(name.c_str(), value); }
+	void setVec3(const std::string &name, const glm::vec3 &value) const { setVec3(name.c_str(), value); }
+	void setVec4(const std::string &name, const glm::vec4 &value) const { setVec4(name.c_str(), value); }
+	void setMat2(const std::string &name, const glm::mat2 &matrix) const { setMat2(name.c_str(), matrix); }
+	void setMat3(const std::string &name, const glm::mat3 &matrix) const { setMat3(name.c_str(), matrix); }
+	void setMat4(const std::string &name, const glm::mat4 &matrix) const { setMat4(name.c_str(), matrix); }
+
 private:
-	//function to check and log any shader compilation errors
-	void m_checkCompileErrors(unsigned int shader, std::string type)
+	//build state kept until the program is first used
+	std::string m_vertexCode;
+	std::string m_fragmentCode;
+	unsigned long long m_cacheKey = 0;
+	unsigned int m_vertex = 0, m_fragment = 0;
+	bool m_pending = false;
+	bool m_fromBinary = false;
+
+	//inserting the defines right after the #version directive, which has to stay the first line
+	static std::string m_InjectDefines(const std::string& source, const std::string& defines)
+	{
+		if (defines.empty())
+			return source;
+
+		std::string::size_type insertAt = 0;
+		if (source.compare(0, 8, "#version") == 0) {
+			insertAt = source.find('\n');
+			insertAt = (insertAt == std::string::npos) ? source.size() : insertAt + 1;
+		}
+		std::string result = source.substr(0, insertAt);
+		result += defines;
+		if (result.back() != '\n')
+			result += '\n';
+		result += source.substr(insertAt);
+		return result;
+	}
+
+	//submitting both stages and the link without querying any status in between
+	void m_SubmitCompile()
+	{
+		//stages with identical sources are only compiled once and shared between programs
+		m_vertex = m_AcquireStage(GL_VERTEX_SHADER, m_vertexCode);
+		m_fragment = m_AcquireStage(GL_FRAGMENT_SHADER, m_fragmentCode);
+
+		//linking the shader program (asking the driver to keep the binary around so it can be cached)
+		glAttachShader(programID, m_vertex);
+		glAttachShader(programID, m_fragment);
+		if (m_ProgramBinarySupported())
+			glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glLinkProgram(programID);
+	}
+
+	//checking the deferred results and doing the post link setup, blocks if the driver is not done yet
+	void m_Finalize()
+	{
+		if (!m_pending)
+			return;
+		m_pending = false;
+
+		//the driver can still reject a cached binary (eg: after an update), in which case we compile after all
+		if (m_fromBinary) {
+			int success = 0;
+			glGetProgramiv(programID, GL_LINK_STATUS, &success);
+			if (success)
+				buildStats().binaryCacheHits++;
+			else
+				m_SubmitCompile();
+		}
+
+		if (m_vertex != 0) {
+			m_checkCompileErrors(m_vertex, "VERTEX");
+			m_checkCompileErrors(m_fragment, "FRAGMENT");
+			if (m_checkCompileErrors(programID, "PROGRAM"))
+				m_SaveProgramBinary(m_cacheKey);
+
+			//releasing the stages, they get deleted once no other pending link needs them
+			glDetachShader(programID, m_vertex);
+			glDetachShader(programID, m_fragment);
+			m_ReleaseStage(m_vertex);
+			m_ReleaseStage(m_fragment);
+			m_vertex = m_fragment = 0;
+		}
+
+		//the sources are not needed anymore
+		m_vertexCode = std::string();
+		m_fragmentCode = std::string();
+
+		//reading every active uniform once so the setters never have to ask the driver again
+		m_ReflectUniforms();
+		m_BindUniformBlocks();
+	}
+
+	//------- STAGE CACHE -------
+	//a compiled shader object shared by every pending program whose stage has the same source
+	struct CachedStage {
+		unsigned int shaderID = 0;
+		unsigned int references = 0;
+		std::string source;			//kept to rule out hash collisions
+	};
+	static std::unordered_map<unsigned long long, CachedStage>& m_StageCache()
+	{
+		static std::unordered_map<unsigned long long, CachedStage> s_stages;
+		return s_stages;
+	}
+
+	static unsigned long long m_StageKey(GLenum type, const std::string& source)
+	{
+		unsigned long long hash = m_HashBytes(14695981039346656037ull, (const char*)&type, sizeof(type));
+		return m_HashBytes(hash, source.c_str(), source.size());
+	}
+
+	//returns a compiled (or still compiling) shader object for the source, reusing one if it is already in flight
+	static unsigned int m_AcquireStage(GLenum type, const std::string& source)
+	{
+		std::unordered_map<unsigned long long, CachedStage>& stages = m_StageCache();
+		unsigned long long key = m_StageKey(type, source);
+
+		std::unordered_map<unsigned long long, CachedStage>::iterator found = stages.find(key);
+		if (found != stages.end() && found->second.source == source) {
+			found->second.references++;
+			buildStats().compilesAvoided++;
+			return found->second.shaderID;
+		}
+
+		const char* code = source.c_str();
+		unsigned int shaderID = glCreateShader(type);
+		glShaderSource(shaderID, 1, &code, NULL);
+		glCompileShader(shaderID);
+		buildStats().stagesCompiled++;
+
+		//on the (very unlikely) hash collision the new stage just isn't cached
+		if (found == stages.end()) {
+			CachedStage& stage = stages[key];
+			stage.shaderID = shaderID;
+			stage.references = 1;
+			stage.source = source;
+		}
+		return shaderID;
+	}
+
+	static void m_ReleaseStage(unsigned int shaderID)
+	{
+		std::unordered_map<unsigned long long, CachedStage>& stages = m_StageCache();
+		for (std::unordered_map<unsigned long long, CachedStage>::iterator it = stages.begin(); it != stages.end(); ++it) {
+			if (it->second.shaderID != shaderID)
+				continue;
+			if (--it->second.references == 0) {
+				glDeleteShader(shaderID);
+				stages.erase(it);
+			}
+			return;
+		}
+
+		//the stage was never cached so nobody else is using it
+		glDeleteShader(shaderID);
+	}
+
+	//open addressing hash table of the active uniforms, names are stored back to back in m_uniformNames
+	struct UniformSlot {
+		unsigned int hash = 0;
+		unsigned int nameOffset = 0;
+		int location = -1;				//-1 marks an empty slot
+	};
+	std::vector<UniformSlot> m_uniformSlots;
+	std::vector<char> m_uniformNames;
+
+	//cpu side copy of the last value uploaded to each slot (size 0 means nothing was uploaded yet)
+	struct ShadowValue {
+		unsigned int size = 0;
+		unsigned char data[sizeof(glm::mat4)];
+	};
+	mutable std::vector<ShadowValue> m_shadowValues;
+	mutable bool m_shadowStale = false;
+
+	//FNV-1a hash of a null terminated uniform name
+	static unsigned int m_HashName(const char* name)
+	{
+		unsigned int hash = 2166136261u;
+		while (*name) {
+			hash ^= (unsigned char)*name++;
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	//returns the table index of a uniform, or -1 if the program has no active uniform with that name
+	int m_FindSlot(const char* name) const
+	{
+		if (m_uniformSlots.empty())
+			return -1;
+
+		unsigned int hash = m_HashName(name);
+		unsigned int mask = (unsigned int)m_uniformSlots.size() - 1;
+		for (unsigned int i = hash & mask; ; i = (i + 1) & mask) {
+			const UniformSlot& slot = m_uniformSlots[i];
+			if (slot.location == -1)				//empty slot, the name is not in the table
+				return -1;
+			if (slot.hash == hash && std::strcmp(m_uniformNames.data() + slot.nameOffset, name) == 0)
+				return (int)i;
+		}
+	}
+
+	//returns the location to upload to, or -1 when the call can be skipped (unknown uniform or unchanged value).
+	//glUniform* writes to whatever program is bound, so the program gets bound (through the cache, free when it
+	//already is) before an upload, otherwise the shadow copy would record a value that went to another program
+	int m_PrepareUpload(const char* name, const void* data, unsigned int size) const
+	{
+		//legacy mode keeps the old behaviour of looking up and uploading every time
+		if (legacyUniformLookup()) {
+			int location = getUniformLocation(name);
+			FrameStats::get().frame.uniformCalls++;
+			m_shadowStale = true;
+			if (location != -1)
+				GLState::useProgram(programID);
+			return location;
+		}
+
+		//anything uploaded in legacy mode bypassed the shadow copies, so they can't be trusted anymore
+		const_cast<Shader*>(this)->m_Finalize();
+		if (m_shadowStale) {
+			m_shadowValues.assign(m_shadowValues.size(), ShadowValue());
+			m_shadowStale = false;
+		}
+		int slot = m_FindSlot(name);
+		if (slot == -1)
+			return -1;
+
+		ShadowValue& shadow = m_shadowValues[slot];
+		if (shadow.size == size && std::memcmp(shadow.data, data, size) == 0) {
+			FrameStats::get().frame.uniformCallsSkipped++;
+			FrameStats::get().frame.uniformBytesSkipped += size;
+			return -1;
+		}
+
+		shadow.size = size;
+		std::memcpy(shadow.data, data, size);
+		FrameStats::get().frame.uniformCalls++;
+		GLState::useProgram(programID);
+		return m_uniformSlots[slot].location;
+	}
+	//listing every active uniform after linking and storing its location in the lookup table
+	void m_ReflectUniforms()
+	{
+		int uniformCount = 0;
+		int maxNameLength = 0;
+		glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &uniformCount);
+		glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+		//collecting the names first, arrays of basic types get an entry per element plus their bare name
+		std::vector<std::string> names;
+		std::vector<char> nameBuffer(maxNameLength + 1);
+		for (int i = 0; i < uniformCount; i++) {
+			int size = 0;
+			GLenum type = 0;
+			glGetActiveUniform(programID, (GLuint)i, (GLsizei)nameBuffer.size(), NULL, &size, &type, nameBuffer.data());
+			std::string name = nameBuffer.data();
+
+			//skipping built in uniforms
+			if (name.compare(0, 3, "gl_") == 0)
+				continue;
+
+			std::string::size_type bracket = name.rfind("[0]");
+			if (size > 1 && bracket == name.size() - 3) {
+				std::string baseName = name.substr(0, bracket);
+				names.push_back(baseName);
+				for (int element = 0; element < size; element++)
+					names.push_back(baseName + "[" + std::to_string(element) + "]");
+			}
+			else {
+				names.push_back(name);
+				//"name[0]" can also be addressed as just "name"
+				if (bracket != std::string::npos && bracket == name.size() - 3)
+					names.push_back(name.substr(0, bracket));
+			}
+		}
+
+		//sizing the table to a power of two with at most 50% load
+		unsigned int capacity = 16;
+		while (capacity < names.size() * 2)
+			capacity *= 2;
+		m_uniformSlots.assign(capacity, UniformSlot());
+		m_shadowValues.assign(capacity, ShadowValue());
+		m_uniformNames.clear();
+
+		unsigned int mask = capacity - 1;
+		for (const std::string& name : names) {
+			//members of uniform blocks have no location
+			int location = glGetUniformLocation(programID, name.c_str());
+			if (location == -1)
+				continue;
+
+			//linear probing until a free slot is found (duplicates are skipped)
+			unsigned int hash = m_HashName(name.c_str());
+			unsigned int i = hash & mask;
+			bool duplicate = false;
+			while (m_uniformSlots[i].location != -1) {
+				if (m_uniformSlots[i].hash == hash && name == m_uniformNames.data() + m_uniformSlots[i].nameOffset) {
+					duplicate = true;
+					break;
+				}
+				i = (i + 1) & mask;
+			}
+			if (duplicate)
+				continue;
+
+			m_uniformSlots[i].hash = hash;
+			m_uniformSlots[i].nameOffset = (unsigned int)m_uniformNames.size();
+			m_uniformSlots[i].location = location;
+			m_uniformNames.insert(m_uniformNames.end(), name.c_str(), name.c_str() + name.size() + 1);
+		}
+	}
+
+	//pointing every shared uniform block of the program at its fixed binding point
+	void m_BindUniformBlocks()
+	{
+		int blockCount = 0;
+		glGetProgramiv(programID, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+
+		char blockName[128];
+		for (int i = 0; i < blockCount; i++) {
+			glGetActiveUniformBlockName(programID, (GLuint)i, sizeof(blockName), NULL, blockName);
+			int binding = uniformBlockBinding(blockName);
+			if (binding != -1)
+				glUniformBlockBinding(programID, (GLuint)i, (GLuint)binding);
+		}
+	}
+
+	//------- PROGRAM BINARY CACHE -------
+	//header written in front of every cached program binary
+	struct ProgramBinaryHeader {
+		unsigned int magic;
+		unsigned int format;
+		unsigned long long key;
+		int length;
+	};
+	static const unsigned int PROGRAM_BINARY_MAGIC = 0x4250474C;		//"LGPB"
+
+	//glProgramBinary is core since 4.1, glad leaves the pointers null on older contexts
+	static bool m_ProgramBinarySupported()
+	{
+		static int s_supported = -1;
+		if (s_supported == -1) {
+			int formatCount = 0;
+			if (glGetProgramBinary && glProgramBinary)
+				glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+			s_supported = formatCount > 0 ? 1 : 0;
+		}
+		return s_supported == 1;
+	}
+
+	static unsigned long long m_HashBytes(unsigned long long hash, const char* data, size_t size)
+	{
+		for (size_t i = 0; i < size; i++) {
+			hash ^= (unsigned char)data[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	//FNV-1a over the final sources plus the driver strings, so a driver update invalidates the cache
+	static unsigned long long m_ProgramCacheKey(const std::string& vertexCode, const std::string& fragmentCode)
+	{
+		unsigned long long hash = 14695981039346656037ull;
+		hash = m_HashBytes(hash, vertexCode.c_str(), vertexCode.size() + 1);
+		hash = m_HashBytes(hash, fragmentCode.c_str(), fragmentCode.size() + 1);
+
+		const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+		for (GLenum name : driverStrings) {
+			const char* value = (const char*)glGetString(name);
+			if (value)
+				hash = m_HashBytes(hash, value, std::strlen(value) + 1);
+		}
+		return hash;
+	}
+
+	static std::string m_ProgramBinaryPath(unsigned long long key)
+	{
+		std::stringstream path;
+		path << binaryCacheDirectory() << '/' << std::hex << key << ".bin";
+		return path.str();
+	}
+
+	//loading a previously linked program, returns false when there is no usable file and the sources need compiling
+	bool m_LoadProgramBinary(unsigned long long key)
+	{
+		if (!m_ProgramBinarySupported())
+			return false;
+
+		std::ifstream file(m_ProgramBinaryPath(key), std::ios::binary);
+		if (!file)
+			return false;
+
+		ProgramBinaryHeader header{};
+		file.read((char*)&header, sizeof(header));
+		if (!file || header.magic != PROGRAM_BINARY_MAGIC || header.key != key || header.length <= 0)
+			return false;
+
+		std::vector<char> binary(header.length);
+		file.read(binary.data(), header.length);
+		if (!file)
+			return false;
+
+		//the link status is only checked in m_Finalize so loading does not stall either
+		glProgramBinary(programID, header.format, binary.data(), header.length);
+		return true;
+	}
+
+	void m_SaveProgramBinary(unsigned long long key)
+	{
+		if (!m_ProgramBinarySupported())
+			return;
+
+		int length = 0;
+		glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+			return;
+
+		ProgramBinaryHeader header{};
+		header.magic = PROGRAM_BINARY_MAGIC;
+		header.key = key;
+		std::vector<char> binary(length);
+		glGetProgramBinary(programID, length, &header.length, &header.format, binary.data());
+
+		std::error_code error;
+		std::filesystem::create_directories(binaryCacheDirectory(), error);
+		std::ofstream file(m_ProgramBinaryPath(key), std::ios::binary | std::ios::trunc);
+		if (!file) {
+			std::cout << "WARNING::SHADER::PROGRAM_BINARY_NOT_WRITTEN: " << m_ProgramBinaryPath(key) << std::endl;
+			return;
+		}
+		file.write((const char*)&header, sizeof(header));
+		file.write(binary.data(), header.length);
+	}
+
+	//function to check and log any shader compilation errors, returns true on success
+	bool m_checkCompileErrors(unsigned int shader, std::string type)
 	{
 		int success;
 		char infoLog[512];
@@ -174,6 +719,7 @@ private:
 			}
 
 		}
+		return success != 0;
 	}
 };
 
@@ -0,0 +1,119 @@
+#pragma once
+#ifndef SHADER_LIBRARY_H
+#define SHADER_LIBRARY_H
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "Shader.h"
+#include "UniformBuffer.h"
+
+//optional inputs a lighting permutation can be specialised for (the diffuse map is always present)
+enum material_feature : unsigned int {
+	FEATURE_SPECULAR_MAP = 1 << 0,
+	FEATURE_EMISSION_MAP = 1 << 1,
+	FEATURE_PACKED_VERTICES = 1 << 2,		//quantized positions that the vertex shader has to decode
+	FEATURE_INSTANCED = 1 << 3,				//per draw data comes from instance attributes instead of uniforms
+
+	FEATURE_ALL = FEATURE_SPECULAR_MAP | FEATURE_EMISSION_MAP | FEATURE_PACKED_VERTICES | FEATURE_INSTANCED
+};
+
+//the point lights that reach one draw, as indices into the Lights block
+struct LightSelection {
+	unsigned int count = 0;
+	glm::ivec4 indices = glm::ivec4(0);
+};
+
+//compiles and caches permutations of one shared vertex + fragment source pair
+class ShaderLibrary {
+public:
+	ShaderLibrary(const char* vertexPath, const char* fragmentPath) : m_vertexPath(vertexPath), m_fragmentPath(fragmentPath) {}
+
+	//returns the program for this material and light count, submitting the permutation the first time it is asked for
+	Shader& get(unsigned int features, unsigned int pointLightCount)
+	{
+		unsigned int key = features | (pointLightCount << 8);
+		std::unique_ptr<Shader>& variant = m_variants[key];
+		if (!variant)
+			variant.reset(new Shader(m_vertexPath.c_str(), m_fragmentPath.c_str(), m_VertexDefines(features), m_FragmentDefines(features, pointLightCount)));
+		return *variant;
+	}
+
+	//submits every light count of a material up front so no permutation gets compiled mid frame
+	void precompile(unsigned int features)
+	{
+		for (unsigned int count = 0; count <= MAX_POINT_LIGHTS; count++)
+			get(features, count);
+	}
+
+	bool isReady()
+	{
+		bool ready = true;
+		for (std::pair<const unsigned int, std::unique_ptr<Shader>>& variant : m_variants)
+			ready = variant.second->isReady() && ready;
+		return ready;
+	}
+
+	size_t variantCount() const { return m_variants.size(); }
+
+	//distance at which a point light has faded to 5/256 of its brightest colour channel
+	static float pointLightRange(const PointLightData& light)
+	{
+		float brightest = glm::max(glm::max(light.diffuse.r, light.diffuse.g), light.diffuse.b);
+		float threshold = light.constant - brightest * (256.0f / 5.0f);
+		if (light.quadratic <= 0.0f)
+			return light.linear > 0.0f ? -threshold / light.linear : 1e30f;
+		return (-light.linear + glm::sqrt(light.linear * light.linear - 4.0f * light.quadratic * threshold)) / (2.0f * light.quadratic);
+	}
+
+	//picks the point lights whose range overlaps a bounding sphere, the count doubles as the permutation to use
+	static LightSelection selectPointLights(const LightsBlock& lights, const glm::vec3& center, float radius)
+	{
+		LightSelection selection;
+		for (unsigned int i = 0; i < MAX_POINT_LIGHTS; i++) {
+			float reach = pointLightRange(lights.pointLights[i]) + radius;
+			glm::vec3 offset = lights.pointLights[i].position - center;
+			if (glm::dot(offset, offset) <= reach * reach)
+				selection.indices[selection.count++] = (int)i;
+		}
+		return selection;
+	}
+
+	//uploads the per draw lighting inputs of a permutation picked with selectPointLights
+	static void applyLightSelection(Shader& shader, const LightSelection& selection)
+	{
+		if (selection.count > 0)
+			shader.setIVec4("u_pointLightIndices", selection.indices);
+	}
+
+private:
+	std::string m_vertexPath;
+	std::string m_fragmentPath;
+	std::unordered_map<unsigned int, std::unique_ptr<Shader>> m_variants;
+
+	//kept separate from the fragment defines so the stage cache can share one vertex stage between light counts
+	static std::string m_VertexDefines(unsigned int features)
+	{
+		std::string defines;
+		if (features & FEATURE_PACKED_VERTICES)
+			defines += "#define QUANTIZED_POSITIONS\n";
+		if (features & FEATURE_INSTANCED)
+			defines += "#define INSTANCED\n";
+		return defines;
+	}
+
+	static std::string m_FragmentDefines(unsigned int features, unsigned int pointLightCount)
+	{
+		std::string defines = "#define NR_POINT_LIGHTS " + std::to_string(pointLightCount) + "\n";
+		if (features & FEATURE_SPECULAR_MAP)
+			defines += "#define HAS_SPECULAR_MAP\n";
+		if (features & FEATURE_EMISSION_MAP)
+			defines += "#define HAS_EMISSION_MAP\n";
+		return defines;
+	}
+};
+
+#endif
@@ -0,0 +1,235 @@
+#pragma once
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "GLState.h"
+#include "FrameStats.h"
+#include "VertexFormat.h"
+
+//ring allocator every per frame upload goes through (uniform blocks, instance data, indirect commands). the buffer is
+//split into one region per frame in flight and a fence per region makes sure the GPU is done reading a region before
+//it gets written again, so uploads never stall on or orphan a buffer the GPU still uses.
+//with GL 4.4 the buffer is mapped once with glBufferStorage + GL_MAP_PERSISTENT_BIT and writes are plain memcpys,
+//on GL 3.3 every write maps its range with GL_MAP_UNSYNCHRONIZED_BIT (the fences doing the synchronizing).
+//a frame that outgrows its region keeps going in extra overflow buffers, and the ring only gets recreated bigger at
+//the start of the next frame, once the GPU is done with all of it, so no write of a frame ever moves or goes away
+class StreamBuffer {
+public:
+	static const unsigned int FRAMES_IN_FLIGHT = 3;
+
+	//where a write landed, buffers are bound at offset of bufferID
+	struct Allocation {
+		unsigned int bufferID = 0;
+		size_t offset = 0;
+	};
+
+	//there is only ever one renderer so the stream is a global singleton, created on first use (needs a context)
+	static StreamBuffer& get()
+	{
+		static StreamBuffer s_stream;
+		return s_stream;
+	}
+
+	static bool persistentSupported()
+	{
+		return GLAD_GL_VERSION_4_4 && glBufferStorage != NULL;
+	}
+
+	bool persistent() const { return m_mapped != NULL; }
+	size_t frameCapacity() const { return m_frameSize; }
+
+	//offsets of uniform blocks have to be multiples of this
+	size_t uniformAlignment() const { return m_uniformAlignment; }
+
+	//moves on to the next region, waiting for the GPU to finish the frame that used it last. if the last frame
+	//overflowed, the ring is made big enough for it first (every buffer binding of the stream has to be made again
+	//after that, which the per frame writes do anyway)
+	void beginFrame()
+	{
+		if (m_grownSize > m_frameSize)
+			m_Grow();
+		m_frame = (m_frame + 1) % FRAMES_IN_FLIGHT;
+		m_WaitForRegion(m_frame);
+		m_head = 0;
+		m_overflowHead = 0;
+		m_overflowSize = 0;
+		m_frameBytes = 0;
+	}
+
+	//fencing the commands that read this frame's region
+	void endFrame()
+	{
+		if (m_fences[m_frame])
+			glDeleteSync(m_fences[m_frame]);
+		m_fences[m_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		if (!m_overflowBuffers.empty())
+			m_grownSize = std::max(m_grownSize, m_Grown(m_frameSize, m_frameBytes));
+	}
+
+	//copying bytes into this frame's region, alignment has to be a power of two
+	Allocation write(const void* data, size_t bytes, size_t alignment = 16)
+	{
+		FrameStats::get().frame.streamedBytes += bytes;
+		m_frameBytes += bytes + alignment;		//what the region would need, padding included
+
+		Allocation allocation;
+		size_t offset = (m_head + alignment - 1) & ~(alignment - 1);
+		if (offset + bytes <= m_frameSize) {
+			allocation.bufferID = m_bufferID;
+			allocation.offset = m_frame * m_frameSize + offset;
+			m_head = offset + bytes;
+			if (bytes == 0)
+				return allocation;
+			if (m_mapped)
+				std::memcpy(m_mapped + allocation.offset, data, bytes);
+			else
+				m_Upload(m_bufferID, allocation.offset, data, bytes);
+			return allocation;
+		}
+
+		//the region is full: the write goes to an overflow buffer that lives until the ring gets grown
+		offset = (m_overflowHead + alignment - 1) & ~(alignment - 1);
+		if (offset + bytes > m_overflowSize) {
+			m_overflowSize = m_Grown(m_frameSize, bytes + alignment);
+			std::cout << "STREAM BUFFER: frame needs more than " << m_frameSize / 1024 << " KB, overflowing into a " << m_overflowSize / 1024 << " KB buffer" << std::endl;
+			unsigned int overflowID;
+			glGenBuffers(1, &overflowID);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, overflowID);
+			glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)m_overflowSize, NULL, GL_STREAM_DRAW);
+			m_overflowBuffers.push_back(overflowID);
+			offset = 0;
+		}
+		allocation.bufferID = m_overflowBuffers.back();
+		allocation.offset = offset;
+		m_overflowHead = offset + bytes;
+		if (bytes > 0)
+			m_Upload(allocation.bufferID, allocation.offset, data, bytes);
+		return allocation;
+	}
+
+private:
+	static const size_t INITIAL_FRAME_SIZE = 1 << 20;
+
+	unsigned int m_bufferID = 0;
+	unsigned char* m_mapped = NULL;		//the whole buffer while persistently mapped
+	size_t m_frameSize = 0;				//bytes of one region
+	size_t m_head = 0;					//bytes used in the current region
+	unsigned int m_frame = 0;
+	GLsync m_fences[FRAMES_IN_FLIGHT] = {};
+	size_t m_uniformAlignment = 256;
+
+	//writes of this frame that did not fit its region, and the size the ring gets grown to at the next frame
+	std::vector<unsigned int> m_overflowBuffers;
+	size_t m_overflowSize = 0;			//bytes of the newest overflow buffer
+	size_t m_overflowHead = 0;			//bytes used in it
+	size_t m_frameBytes = 0;			//everything this frame asked for
+	size_t m_grownSize = 0;
+
+	StreamBuffer()
+	{
+		GLint alignment = 0;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		if (alignment > 0)
+			m_uniformAlignment = (size_t)alignment;
+
+		m_Create(INITIAL_FRAME_SIZE);
+		std::cout << "STREAM BUFFER: " << FRAMES_IN_FLIGHT << " x " << m_frameSize / 1024 << " KB, "
+			<< (persistent() ? "persistently mapped" : "unsynchronized glMapBufferRange") << std::endl;
+	}
+
+	//doubling until a whole region is free for the write that did not fit
+	static size_t m_Grown(size_t size, size_t needed)
+	{
+		size *= 2;
+		while (size < needed)
+			size *= 2;
+		return size;
+	}
+
+	//recreating the ring at the size the biggest overflowing frame needed. only called between frames, after waiting for
+	//every region, so nothing the GPU may still read gets deleted
+	void m_Grow()
+	{
+		std::cout << "STREAM BUFFER: growing from " << m_frameSize / 1024 << " KB to " << m_grownSize / 1024 << " KB per frame" << std::endl;
+		for (unsigned int region = 0; region < FRAMES_IN_FLIGHT; region++)
+			m_WaitForRegion(region);
+
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_bufferID);
+		if (m_mapped)
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glDeleteBuffers(1, &m_bufferID);
+		if (!m_overflowBuffers.empty())
+			glDeleteBuffers((GLsizei)m_overflowBuffers.size(), &m_overflowBuffers[0]);
+		m_overflowBuffers.clear();
+		//the deleted names can come back from glGenBuffers, so cached bindings of them are not to be trusted
+		GLState::invalidate();
+		InstanceAttributes::invalidate();
+
+		m_Create(m_grownSize);
+	}
+
+	//creating the buffer with frameSize bytes per region
+	void m_Create(size_t frameSize)
+	{
+		m_frameSize = frameSize;
+		m_mapped = NULL;
+		GLsizeiptr totalSize = (GLsizeiptr)(frameSize * FRAMES_IN_FLIGHT);
+
+		glGenBuffers(1, &m_bufferID);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_bufferID);
+		if (persistentSupported()) {
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_COPY_WRITE_BUFFER, totalSize, NULL, flags);
+			m_mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalSize, flags);
+			if (!m_mapped)
+				std::cout << "ERROR::STREAM_BUFFER::PERSISTENT_MAP_FAILED" << std::endl;
+		}
+		else {
+			glBufferData(GL_COPY_WRITE_BUFFER, totalSize, NULL, GL_STREAM_DRAW);
+		}
+	}
+
+	//writing through a mapping of just the range, the fences make sure nothing still reads it
+	static void m_Upload(unsigned int bufferID, size_t offset, const void* data, size_t bytes)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, bufferID);
+		void* target = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, bytes, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+		if (target) {
+			std::memcpy(target, data, bytes);
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		}
+		else {
+			std::cout << "ERROR::STREAM_BUFFER::MAP_FAILED" << std::endl;
+		}
+	}
+
+	void m_WaitForRegion(unsigned int region)
+	{
+		GLsync fence = m_fences[region];
+		if (!fence)
+			return;
+
+		//only counting it as a wait when the GPU really was behind
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED) {
+			FrameStats::get().frame.streamWaits++;
+			do {
+				result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			} while (result == GL_TIMEOUT_EXPIRED);
+		}
+		if (result == GL_WAIT_FAILED)
+			std::cout << "ERROR::STREAM_BUFFER::FENCE_WAIT_FAILED" << std::endl;
+
+		glDeleteSync(fence);
+		m_fences[region] = NULL;
+	}
+};
+
+#endif
@@ -0,0 +1,132 @@
+#pragma once
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//worker threads shared by everything that splits CPU work up (software occlusion, model loading). jobs never touch
+//GL, only the thread owning the context does. parallelFor lets the calling thread work through the items too, so it
+//can be called from a job without waiting on workers that are all busy
+class ThreadPool {
+public:
+	//one pool for the whole program, created on first use with a worker per core besides the calling one
+	static ThreadPool& get()
+	{
+		static ThreadPool s_pool;
+		return s_pool;
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+		m_wake.notify_all();
+		for (unsigned int i = 0; i < m_workers.size(); i++)
+			m_workers[i].join();
+	}
+
+	//threads working on a parallelFor, the calling one included
+	unsigned int threadCount() const { return (unsigned int)m_workers.size() + 1; }
+
+	//running a job on a worker some time later
+	void submit(std::function<void()> job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_jobs.push_back(std::move(job));
+		}
+		m_wake.notify_one();
+	}
+
+	//calling body(i) for every i below count spread over the workers, returns once every call is done
+	void parallelFor(unsigned int count, const std::function<void(unsigned int)>& body)
+	{
+		if (count == 0)
+			return;
+		if (count == 1) {
+			body(0);
+			return;
+		}
+
+		std::shared_ptr<ParallelLoop> loop = std::make_shared<ParallelLoop>();
+		loop->count = count;
+		loop->body = &body;
+		unsigned int helpers = std::min(count - 1, (unsigned int)m_workers.size());
+		for (unsigned int i = 0; i < helpers; i++)
+			submit([loop]() { m_RunLoop(*loop); });
+
+		m_RunLoop(*loop);
+		std::unique_lock<std::mutex> lock(loop->mutex);
+		loop->finished.wait(lock, [&]() { return loop->done == loop->count; });
+	}
+
+private:
+	//state of one parallelFor, shared with the helper jobs (which may only start after the loop is over)
+	struct ParallelLoop {
+		std::atomic<unsigned int> next{ 0 };
+		unsigned int count = 0;
+		unsigned int done = 0;
+		const std::function<void(unsigned int)>* body = NULL;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+
+	std::vector<std::thread> m_workers;
+	std::deque<std::function<void()> > m_jobs;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	bool m_stopping = false;
+
+	ThreadPool()
+	{
+		unsigned int cores = std::thread::hardware_concurrency();
+		unsigned int workers = cores > 1 ? cores - 1 : 1;
+		for (unsigned int i = 0; i < workers; i++)
+			m_workers.push_back(std::thread(&ThreadPool::m_Work, this));
+	}
+
+	void m_Work()
+	{
+		for (;;) {
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_wake.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+				if (m_stopping && m_jobs.empty())
+					return;
+				job = std::move(m_jobs.front());
+				m_jobs.pop_front();
+			}
+			job();
+		}
+	}
+
+	//taking items until there are none left, the last one to finish wakes the caller
+	static void m_RunLoop(ParallelLoop& loop)
+	{
+		unsigned int finished = 0;
+		for (unsigned int i = loop.next++; i < loop.count; i = loop.next++) {
+			(*loop.body)(i);
+			finished++;
+		}
+		if (finished == 0)
+			return;
+
+		std::lock_guard<std::mutex> lock(loop.mutex);
+		loop.done += finished;
+		if (loop.done == loop.count)
+			loop.finished.notify_all();
+	}
+};
+
+#endif
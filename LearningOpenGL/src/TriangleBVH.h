@@ -0,0 +1,658 @@
+#pragma once
+#ifndef TRIANGLE_BVH_H
+#define TRIANGLE_BVH_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#define TRIANGLE_BVH_SSE
+#endif
+
+#include "VertexFormat.h"
+
+//bounding volume hierarchy over a mesh's triangles for ray and sphere queries in model space (camera collision,
+//picking). built top down with a binned SAH, every leaf holding its triangles in packets of 4 laid out as structure
+//of arrays so one SSE pass tests 4 triangles. building a big mesh takes a while, so the finished tree is written to
+//cacheDirectory() keyed by a hash of the geometry and loaded from there next time
+class TriangleBVH {
+public:
+	//closest hit along a ray, distance in units of the ray's direction
+	struct RayHit {
+		float distance;
+		glm::vec3 normal;			//unit face normal, facing against the ray
+		unsigned int triangle;		//index into the mesh's indices / 3
+	};
+
+	//point of a triangle inside a sphere
+	struct SphereContact {
+		glm::vec3 point;			//closest point of the triangle to the sphere's center
+		glm::vec3 normal;			//unit face normal, facing the sphere's center
+		unsigned int triangle;
+	};
+
+	//folder the built trees get cached in (relative to the working directory), empty turns the cache off
+	static std::string& cacheDirectory()
+	{
+		static std::string s_directory = "cache/bvh";
+		return s_directory;
+	}
+
+	void build(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+	{
+		m_nodes.clear();
+		m_packets.clear();
+		m_depth = 0;
+		if (indices.size() < 3)
+			return;
+
+		unsigned long long key = m_CacheKey(vertices, indices);
+		if (m_Load(key))
+			return;
+
+		m_Build(vertices, indices);
+		m_Save(key);
+	}
+
+	bool empty() const { return m_nodes.empty(); }
+	size_t nodeCount() const { return m_nodes.size(); }
+
+	//closest triangle the ray hits before maxDistance, from both sides
+	bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RayHit& hit) const
+	{
+		if (m_nodes.empty())
+			return false;
+
+		glm::vec3 inverse = 1.0f / direction;
+		float best = maxDistance;
+		unsigned int bestPacket = 0, bestLane = 0;
+		bool found = false;
+
+		unsigned int fixedStack[STACK_SIZE];
+		std::vector<unsigned int> deepStack;
+		unsigned int* stack = m_TraversalStack(fixedStack, deepStack);
+		unsigned int stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0) {
+			const Node& node = m_nodes[stack[--stackSize]];
+			float entry;
+			if (!m_RayBox(origin, inverse, node.minimum, node.maximum, best, entry))
+				continue;
+
+			if (node.count > 0) {
+				for (unsigned int p = node.leftFirst; p < node.leftFirst + node.count; p++) {
+					int lane = m_RayPacket(m_packets[p], origin, direction, best);
+					if (lane >= 0) {
+						bestPacket = p;
+						bestLane = (unsigned int)lane;
+						found = true;
+					}
+				}
+				continue;
+			}
+
+			//visiting the nearer child first so the further one is more likely to get pruned by the closer hit
+			float leftEntry, rightEntry;
+			bool left = m_RayBox(origin, inverse, m_nodes[node.leftFirst].minimum, m_nodes[node.leftFirst].maximum, best, leftEntry);
+			bool right = m_RayBox(origin, inverse, m_nodes[node.leftFirst + 1].minimum, m_nodes[node.leftFirst + 1].maximum, best, rightEntry);
+			if (left && right && leftEntry < rightEntry) {
+				stack[stackSize++] = node.leftFirst + 1;
+				stack[stackSize++] = node.leftFirst;
+			}
+			else {
+				if (left)
+					stack[stackSize++] = node.leftFirst;
+				if (right)
+					stack[stackSize++] = node.leftFirst + 1;
+			}
+		}
+		if (!found)
+			return false;
+
+		const TrianglePacket& packet = m_packets[bestPacket];
+		glm::vec3 edge1 = m_Lane(packet.edge1, bestLane), edge2 = m_Lane(packet.edge2, bestLane);
+		hit.distance = best;
+		hit.normal = glm::normalize(glm::cross(edge1, edge2));
+		if (glm::dot(hit.normal, direction) > 0.0f)
+			hit.normal = -hit.normal;
+		hit.triangle = packet.triangle[bestLane];
+		return true;
+	}
+
+	//every triangle touching the sphere
+	void querySphere(const glm::vec3& center, float radius, std::vector<SphereContact>& contacts) const
+	{
+		if (m_nodes.empty())
+			return;
+
+		unsigned int fixedStack[STACK_SIZE];
+		std::vector<unsigned int> deepStack;
+		unsigned int* stack = m_TraversalStack(fixedStack, deepStack);
+		unsigned int stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0) {
+			const Node& node = m_nodes[stack[--stackSize]];
+			glm::vec3 offset = glm::clamp(center, node.minimum, node.maximum) - center;
+			if (glm::dot(offset, offset) > radius * radius)
+				continue;
+
+			if (node.count == 0) {
+				stack[stackSize++] = node.leftFirst;
+				stack[stackSize++] = node.leftFirst + 1;
+				continue;
+			}
+
+			for (unsigned int p = node.leftFirst; p < node.leftFirst + node.count; p++) {
+				const TrianglePacket& packet = m_packets[p];
+				int candidates = m_SpherePlanes(packet, center, radius);
+				for (unsigned int lane = 0; lane < 4; lane++) {
+					if (!(candidates & (1 << lane)))
+						continue;
+					glm::vec3 a = m_Lane(packet.v0, lane);
+					glm::vec3 b = a + m_Lane(packet.edge1, lane);
+					glm::vec3 c = a + m_Lane(packet.edge2, lane);
+					glm::vec3 point = m_ClosestPointOnTriangle(center, a, b, c);
+					glm::vec3 toCenter = center - point;
+					if (glm::dot(toCenter, toCenter) > radius * radius)
+						continue;
+
+					SphereContact contact;
+					contact.point = point;
+					contact.normal = glm::normalize(glm::cross(b - a, c - a));
+					if (glm::dot(contact.normal, toCenter) < 0.0f)
+						contact.normal = -contact.normal;
+					contact.triangle = packet.triangle[lane];
+					contacts.push_back(contact);
+				}
+			}
+		}
+	}
+
+private:
+	static const unsigned int LEAF_TRIANGLES = 4;		//one packet
+	static const unsigned int SAH_BINS = 16;
+	static const unsigned int STACK_SIZE = 64;		//traversal stack on the stack, deeper trees get one on the heap
+	static const unsigned int CACHE_MAGIC = 0x48564254;		//"TBVH"
+	static const unsigned int CACHE_VERSION = 2;
+
+	//children of an internal node are next to each other at leftFirst, a leaf (count > 0) holds count packets from leftFirst
+	struct Node {
+		glm::vec3 minimum;
+		unsigned int leftFirst;
+		glm::vec3 maximum;
+		unsigned int count;
+	};
+
+	//4 triangles as a corner and the two edges leaving it, the unused lanes of a leaf's last packet are degenerate
+	struct TrianglePacket {
+		float v0[3][4];
+		float edge1[3][4];
+		float edge2[3][4];
+		unsigned int triangle[4];
+	};
+
+	struct CacheHeader {
+		unsigned int magic;
+		unsigned int version;
+		unsigned long long key;
+		unsigned int nodeCount;
+		unsigned int packetCount;
+		unsigned int depth;
+	};
+
+	std::vector<Node> m_nodes;
+	std::vector<TrianglePacket> m_packets;
+	unsigned int m_depth = 0;		//levels of the deepest leaf, the root being 1
+
+	//a depth first traversal holds at most one waiting sibling per level above the node it is at plus the two
+	//children it pushes, so depth + 1 entries always fit
+	unsigned int* m_TraversalStack(unsigned int* fixedStack, std::vector<unsigned int>& deepStack) const
+	{
+		if (m_depth + 1 <= STACK_SIZE)
+			return fixedStack;
+		deepStack.resize(m_depth + 1);
+		return &deepStack[0];
+	}
+
+	static glm::vec3 m_Lane(const float values[3][4], unsigned int lane)
+	{
+		return glm::vec3(values[0][lane], values[1][lane], values[2][lane]);
+	}
+
+	//slab test, entry is where the ray enters the box (0 when it starts inside)
+	static bool m_RayBox(const glm::vec3& origin, const glm::vec3& inverse, const glm::vec3& minimum, const glm::vec3& maximum, float maxDistance, float& entry)
+	{
+		glm::vec3 t0 = (minimum - origin) * inverse;
+		glm::vec3 t1 = (maximum - origin) * inverse;
+		glm::vec3 near = glm::min(t0, t1), far = glm::max(t0, t1);
+		entry = glm::max(glm::max(glm::max(near.x, near.y), near.z), 0.0f);
+		float exit = glm::min(glm::min(glm::min(far.x, far.y), far.z), maxDistance);
+		return entry <= exit;
+	}
+
+	//Moller-Trumbore on the 4 triangles of a packet, lowering best and returning the lane when one is hit closer
+	static int m_RayPacket(const TrianglePacket& packet, const glm::vec3& origin, const glm::vec3& direction, float& best)
+	{
+#if defined(TRIANGLE_BVH_SSE)
+		__m128 dx = _mm_set1_ps(direction.x), dy = _mm_set1_ps(direction.y), dz = _mm_set1_ps(direction.z);
+		__m128 e1x = _mm_loadu_ps(packet.edge1[0]), e1y = _mm_loadu_ps(packet.edge1[1]), e1z = _mm_loadu_ps(packet.edge1[2]);
+		__m128 e2x = _mm_loadu_ps(packet.edge2[0]), e2y = _mm_loadu_ps(packet.edge2[1]), e2z = _mm_loadu_ps(packet.edge2[2]);
+
+		//p = direction x edge2, det = edge1 . p
+		__m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+		__m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+		__m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+		__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+		__m128 absDet = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+		__m128 inverseDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+		//s = origin - v0, u = (s . p) / det
+		__m128 sx = _mm_sub_ps(_mm_set1_ps(origin.x), _mm_loadu_ps(packet.v0[0]));
+		__m128 sy = _mm_sub_ps(_mm_set1_ps(origin.y), _mm_loadu_ps(packet.v0[1]));
+		__m128 sz = _mm_sub_ps(_mm_set1_ps(origin.z), _mm_loadu_ps(packet.v0[2]));
+		__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inverseDet);
+
+		//q = s x edge1, v = (direction . q) / det, t = (edge2 . q) / det
+		__m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+		__m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+		__m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+		__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inverseDet);
+		__m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverseDet);
+
+		__m128 zero = _mm_setzero_ps();
+		__m128 hit = _mm_cmpgt_ps(absDet, _mm_set1_ps(1e-12f));
+		hit = _mm_and_ps(hit, _mm_cmpge_ps(u, zero));
+		hit = _mm_and_ps(hit, _mm_cmpge_ps(v, zero));
+		hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+		hit = _mm_and_ps(hit, _mm_cmpgt_ps(t, zero));
+		hit = _mm_and_ps(hit, _mm_cmplt_ps(t, _mm_set1_ps(best)));
+		int mask = _mm_movemask_ps(hit);
+		if (mask == 0)
+			return -1;
+
+		float distances[4];
+		_mm_storeu_ps(distances, t);
+		int closest = -1;
+		for (int lane = 0; lane < 4; lane++) {
+			if ((mask & (1 << lane)) && distances[lane] < best) {
+				best = distances[lane];
+				closest = lane;
+			}
+		}
+		return closest;
+#else
+		int closest = -1;
+		for (unsigned int lane = 0; lane < 4; lane++) {
+			glm::vec3 edge1 = m_Lane(packet.edge1, lane), edge2 = m_Lane(packet.edge2, lane);
+			glm::vec3 p = glm::cross(direction, edge2);
+			float det = glm::dot(edge1, p);
+			if (glm::abs(det) <= 1e-12f)
+				continue;
+			float inverseDet = 1.0f / det;
+			glm::vec3 s = origin - m_Lane(packet.v0, lane);
+			float u = glm::dot(s, p) * inverseDet;
+			glm::vec3 q = glm::cross(s, edge1);
+			float v = glm::dot(direction, q) * inverseDet;
+			float t = glm::dot(edge2, q) * inverseDet;
+			if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t > 0.0f && t < best) {
+				best = t;
+				closest = (int)lane;
+			}
+		}
+		return closest;
+#endif
+	}
+
+	//lanes whose triangle's plane passes within radius of the center, only those need the exact closest point
+	static int m_SpherePlanes(const TrianglePacket& packet, const glm::vec3& center, float radius)
+	{
+#if defined(TRIANGLE_BVH_SSE)
+		__m128 e1x = _mm_loadu_ps(packet.edge1[0]), e1y = _mm_loadu_ps(packet.edge1[1]), e1z = _mm_loadu_ps(packet.edge1[2]);
+		__m128 e2x = _mm_loadu_ps(packet.edge2[0]), e2y = _mm_loadu_ps(packet.edge2[1]), e2z = _mm_loadu_ps(packet.edge2[2]);
+		__m128 nx = _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y));
+		__m128 ny = _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z));
+		__m128 nz = _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x));
+		__m128 sx = _mm_sub_ps(_mm_set1_ps(center.x), _mm_loadu_ps(packet.v0[0]));
+		__m128 sy = _mm_sub_ps(_mm_set1_ps(center.y), _mm_loadu_ps(packet.v0[1]));
+		__m128 sz = _mm_sub_ps(_mm_set1_ps(center.z), _mm_loadu_ps(packet.v0[2]));
+
+		//(s . n)^2 <= radius^2 * |n|^2, without normalizing n
+		__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, nx), _mm_mul_ps(sy, ny)), _mm_mul_ps(sz, nz));
+		__m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz));
+		__m128 inside = _mm_cmple_ps(_mm_mul_ps(distance, distance), _mm_mul_ps(_mm_set1_ps(radius * radius), lengthSquared));
+		inside = _mm_and_ps(inside, _mm_cmpgt_ps(lengthSquared, _mm_setzero_ps()));
+		return _mm_movemask_ps(inside);
+#else
+		int mask = 0;
+		for (unsigned int lane = 0; lane < 4; lane++) {
+			glm::vec3 normal = glm::cross(m_Lane(packet.edge1, lane), m_Lane(packet.edge2, lane));
+			float lengthSquared = glm::dot(normal, normal);
+			float distance = glm::dot(center - m_Lane(packet.v0, lane), normal);
+			if (lengthSquared > 0.0f && distance * distance <= radius * radius * lengthSquared)
+				mask |= 1 << lane;
+		}
+		return mask;
+#endif
+	}
+
+	//Ericson's closest point on a triangle, by the voronoi region of the point
+	static glm::vec3 m_ClosestPointOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+	{
+		glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+		float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+		if (d1 <= 0.0f && d2 <= 0.0f)
+			return a;
+
+		glm::vec3 bp = p - b;
+		float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+		if (d3 >= 0.0f && d4 <= d3)
+			return b;
+
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+			return a + ab * (d1 / (d1 - d3));
+
+		glm::vec3 cp = p - c;
+		float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+		if (d6 >= 0.0f && d5 <= d6)
+			return c;
+
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+			return a + ac * (d2 / (d2 - d6));
+
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+			return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+		float denominator = 1.0f / (va + vb + vc);
+		return a + ab * (vb * denominator) + ac * (vc * denominator);
+	}
+
+	//top down over the triangles' centroids, children get allocated in pairs
+	void m_Build(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+	{
+		unsigned int triangleCount = (unsigned int)(indices.size() / 3);
+		std::vector<unsigned int> triangles(triangleCount);
+		std::vector<glm::vec3> centroids(triangleCount);
+		std::vector<glm::vec3> minimums(triangleCount), maximums(triangleCount);
+		for (unsigned int i = 0; i < triangleCount; i++) {
+			const glm::vec3& a = vertices[indices[i * 3]].position;
+			const glm::vec3& b = vertices[indices[i * 3 + 1]].position;
+			const glm::vec3& c = vertices[indices[i * 3 + 2]].position;
+			triangles[i] = i;
+			minimums[i] = glm::min(glm::min(a, b), c);
+			maximums[i] = glm::max(glm::max(a, b), c);
+			centroids[i] = (a + b + c) / 3.0f;
+		}
+
+		m_nodes.reserve(triangleCount * 2 / LEAF_TRIANGLES + 1);
+		m_nodes.push_back(Node());
+		//nodes still to split with their depth, their range kept in leftFirst/count until then
+		std::vector<std::pair<unsigned int, unsigned int> > pending;
+		m_nodes[0].leftFirst = 0;
+		m_nodes[0].count = triangleCount;
+		pending.push_back(std::make_pair(0u, 1u));
+
+		while (!pending.empty()) {
+			unsigned int index = pending.back().first, depth = pending.back().second;
+			pending.pop_back();
+			m_depth = std::max(m_depth, depth);
+			unsigned int first = m_nodes[index].leftFirst, count = m_nodes[index].count;
+
+			glm::vec3 minimum(1e30f), maximum(-1e30f), centroidMin(1e30f), centroidMax(-1e30f);
+			for (unsigned int i = first; i < first + count; i++) {
+				minimum = glm::min(minimum, minimums[triangles[i]]);
+				maximum = glm::max(maximum, maximums[triangles[i]]);
+				centroidMin = glm::min(centroidMin, centroids[triangles[i]]);
+				centroidMax = glm::max(centroidMax, centroids[triangles[i]]);
+			}
+			m_nodes[index].minimum = minimum;
+			m_nodes[index].maximum = maximum;
+
+			unsigned int middle = count > LEAF_TRIANGLES ? m_Split(triangles, centroids, minimums, maximums, first, count, centroidMin, centroidMax) : first;
+			if (middle == first || middle == first + count) {
+				//a leaf: its range stays in the node until the packets get written
+				continue;
+			}
+
+			unsigned int left = (unsigned int)m_nodes.size();
+			m_nodes.push_back(Node());
+			m_nodes.push_back(Node());
+			m_nodes[left].leftFirst = first;
+			m_nodes[left].count = middle - first;
+			m_nodes[left + 1].leftFirst = middle;
+			m_nodes[left + 1].count = first + count - middle;
+			m_nodes[index].leftFirst = left;
+			m_nodes[index].count = 0;
+			pending.push_back(std::make_pair(left + 1, depth + 1));
+			pending.push_back(std::make_pair(left, depth + 1));
+		}
+
+		//turning every leaf's triangle range into packets
+		for (unsigned int n = 0; n < m_nodes.size(); n++) {
+			Node& node = m_nodes[n];
+			if (node.count == 0)
+				continue;
+			unsigned int first = node.leftFirst, count = node.count;
+			node.leftFirst = (unsigned int)m_packets.size();
+			node.count = (count + 3) / 4;
+			for (unsigned int i = 0; i < count; i += 4) {
+				TrianglePacket packet;
+				std::memset(&packet, 0, sizeof(packet));
+				for (unsigned int lane = 0; lane < 4 && i + lane < count; lane++) {
+					unsigned int triangle = triangles[first + i + lane];
+					const glm::vec3& a = vertices[indices[triangle * 3]].position;
+					glm::vec3 edge1 = vertices[indices[triangle * 3 + 1]].position - a;
+					glm::vec3 edge2 = vertices[indices[triangle * 3 + 2]].position - a;
+					for (int axis = 0; axis < 3; axis++) {
+						packet.v0[axis][lane] = a[axis];
+						packet.edge1[axis][lane] = edge1[axis];
+						packet.edge2[axis][lane] = edge2[axis];
+					}
+					packet.triangle[lane] = triangle;
+				}
+				m_packets.push_back(packet);
+			}
+		}
+	}
+
+	//partitioning triangles[first, first + count) at the cheapest bin boundary, returns where the right half starts
+	//(first when no split beats keeping them together)
+	static unsigned int m_Split(std::vector<unsigned int>& triangles, const std::vector<glm::vec3>& centroids, const std::vector<glm::vec3>& minimums,
+		const std::vector<glm::vec3>& maximums, unsigned int first, unsigned int count, const glm::vec3& centroidMin, const glm::vec3& centroidMax)
+	{
+		int bestAxis = -1;
+		unsigned int bestBin = 0;
+		float bestCost = 1e30f;
+		for (int axis = 0; axis < 3; axis++) {
+			float extent = centroidMax[axis] - centroidMin[axis];
+			if (extent <= 0.0f)
+				continue;
+
+			glm::vec3 binMin[SAH_BINS], binMax[SAH_BINS];
+			unsigned int binCount[SAH_BINS] = {};
+			for (unsigned int b = 0; b < SAH_BINS; b++) {
+				binMin[b] = glm::vec3(1e30f);
+				binMax[b] = glm::vec3(-1e30f);
+			}
+			for (unsigned int i = first; i < first + count; i++) {
+				unsigned int triangle = triangles[i];
+				unsigned int b = m_Bin(centroids[triangle][axis], centroidMin[axis], extent);
+				binMin[b] = glm::min(binMin[b], minimums[triangle]);
+				binMax[b] = glm::max(binMax[b], maximums[triangle]);
+				binCount[b]++;
+			}
+
+			float rightArea[SAH_BINS];
+			unsigned int rightCount[SAH_BINS];
+			glm::vec3 sweepMin(1e30f), sweepMax(-1e30f);
+			unsigned int sweepCount = 0;
+			for (unsigned int b = SAH_BINS - 1; b > 0; b--) {
+				sweepMin = glm::min(sweepMin, binMin[b]);
+				sweepMax = glm::max(sweepMax, binMax[b]);
+				sweepCount += binCount[b];
+				rightArea[b] = sweepCount ? m_Area(sweepMin, sweepMax) : 0.0f;
+				rightCount[b] = sweepCount;
+			}
+			sweepMin = glm::vec3(1e30f);
+			sweepMax = glm::vec3(-1e30f);
+			sweepCount = 0;
+			for (unsigned int b = 0; b < SAH_BINS - 1; b++) {
+				sweepMin = glm::min(sweepMin, binMin[b]);
+				sweepMax = glm::max(sweepMax, binMax[b]);
+				sweepCount += binCount[b];
+				if (sweepCount == 0 || rightCount[b + 1] == 0)
+					continue;
+				//costs counted in packets, a packet of 1 triangle costs as much as one of 4
+				float cost = ((sweepCount + 3) / 4) * m_Area(sweepMin, sweepMax) + ((rightCount[b + 1] + 3) / 4) * rightArea[b + 1];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = b;
+				}
+			}
+		}
+
+		//every centroid in one spot: halving the range still keeps the leaves small
+		if (bestAxis == -1)
+			return first + count / 2;
+
+		float extent = centroidMax[bestAxis] - centroidMin[bestAxis];
+		std::vector<unsigned int>::iterator split = std::partition(triangles.begin() + first, triangles.begin() + first + count, [&](unsigned int triangle) {
+			return m_Bin(centroids[triangle][bestAxis], centroidMin[bestAxis], extent) <= bestBin;
+		});
+		return (unsigned int)(split - triangles.begin());
+	}
+
+	static unsigned int m_Bin(float centroid, float minimum, float extent)
+	{
+		unsigned int bin = (unsigned int)((centroid - minimum) / extent * SAH_BINS);
+		return bin < SAH_BINS ? bin : SAH_BINS - 1;
+	}
+
+	static float m_Area(const glm::vec3& minimum, const glm::vec3& maximum)
+	{
+		glm::vec3 size = maximum - minimum;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	//FNV-1a over the positions and indices, the only inputs of the build
+	static unsigned long long m_CacheKey(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+	{
+		unsigned long long hash = 14695981039346656037ull;
+		for (unsigned int i = 0; i < vertices.size(); i++)
+			hash = m_HashBytes(hash, (const char*)&vertices[i].position, sizeof(glm::vec3));
+		return m_HashBytes(hash, (const char*)&indices[0], indices.size() * sizeof(unsigned int));
+	}
+
+	static unsigned long long m_HashBytes(unsigned long long hash, const char* data, size_t size)
+	{
+		for (size_t i = 0; i < size; i++) {
+			hash ^= (unsigned char)data[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	static std::string m_CachePath(unsigned long long key)
+	{
+		std::stringstream path;
+		path << cacheDirectory() << '/' << std::hex << key << ".bvh";
+		return path.str();
+	}
+
+	bool m_Load(unsigned long long key)
+	{
+		if (cacheDirectory().empty())
+			return false;
+
+		std::ifstream file(m_CachePath(key), std::ios::binary | std::ios::ate);
+		if (!file)
+			return false;
+		std::streamoff fileSize = file.tellg();
+		file.seekg(0);
+
+		CacheHeader header{};
+		file.read((char*)&header, sizeof(header));
+		if (!file || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION || header.key != key || header.nodeCount == 0 || header.depth == 0)
+			return false;
+		//a truncated or padded file is not one this build wrote completely
+		unsigned long long expectedSize = sizeof(CacheHeader) + (unsigned long long)header.nodeCount * sizeof(Node) + (unsigned long long)header.packetCount * sizeof(TrianglePacket);
+		if ((unsigned long long)fileSize != expectedSize)
+			return false;
+
+		m_nodes.resize(header.nodeCount);
+		m_packets.resize(header.packetCount);
+		m_depth = header.depth;
+		file.read((char*)&m_nodes[0], m_nodes.size() * sizeof(Node));
+		file.read((char*)&m_packets[0], m_packets.size() * sizeof(TrianglePacket));
+		if (!file) {
+			m_nodes.clear();
+			m_packets.clear();
+			m_depth = 0;
+			return false;
+		}
+		return true;
+	}
+
+	void m_Save(unsigned long long key)
+	{
+		if (cacheDirectory().empty())
+			return;
+
+		CacheHeader header{};
+		header.magic = CACHE_MAGIC;
+		header.version = CACHE_VERSION;
+		header.key = key;
+		header.nodeCount = (unsigned int)m_nodes.size();
+		header.packetCount = (unsigned int)m_packets.size();
+		header.depth = m_depth;
+
+		//meshes with the same geometry get built on several workers (or by another run) at once, so every writer gets
+		//its own file and renames it over the cached one when complete, a reader never sees a half written tree
+		static std::atomic<unsigned int> s_saveCount{ 0 };
+		std::stringstream temporaryPath;
+		temporaryPath << m_CachePath(key) << '.' << std::hash<std::thread::id>()(std::this_thread::get_id()) << '.'
+			<< std::chrono::steady_clock::now().time_since_epoch().count() << '.' << s_saveCount++ << ".tmp";
+
+		std::error_code error;
+		std::filesystem::create_directories(cacheDirectory(), error);
+		{
+			std::ofstream file(temporaryPath.str(), std::ios::binary | std::ios::trunc);
+			if (!file) {
+				std::cout << "WARNING::TRIANGLE_BVH::CACHE_NOT_WRITTEN: " << m_CachePath(key) << std::endl;
+				return;
+			}
+			file.write((const char*)&header, sizeof(header));
+			file.write((const char*)&m_nodes[0], m_nodes.size() * sizeof(Node));
+			file.write((const char*)&m_packets[0], m_packets.size() * sizeof(TrianglePacket));
+			if (!file) {
+				file.close();
+				std::filesystem::remove(temporaryPath.str(), error);
+				std::cout << "WARNING::TRIANGLE_BVH::CACHE_NOT_WRITTEN: " << m_CachePath(key) << std::endl;
+				return;
+			}
+		}
+
+		//losing the race to another writer of the same tree is fine, theirs is just as good
+		std::filesystem::rename(temporaryPath.str(), m_CachePath(key), error);
+		if (error)
+			std::filesystem::remove(temporaryPath.str(), error);
+	}
+};
+
+#endif
@@ -0,0 +1,106 @@
+#pragma once
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <cstring>
+
+#include "GLState.h"
+#include "StreamBuffer.h"
+
+//fixed binding points of the uniform blocks shared by every program
+enum uniform_block_binding {
+	FRAME_DATA_BINDING = 0,
+	LIGHTS_BINDING = 1
+};
+
+//returns the binding point a uniform block with this name gets bound to, or -1 if it is not a shared block
+inline int uniformBlockBinding(const char* blockName)
+{
+	if (std::strcmp(blockName, "FrameData") == 0)
+		return FRAME_DATA_BINDING;
+	if (std::strcmp(blockName, "Lights") == 0)
+		return LIGHTS_BINDING;
+	return -1;
+}
+
+//------- std140 layouts (must match the blocks declared in res/shaders) -------
+
+//camera data that changes once per frame
+struct FrameDataBlock {
+	glm::mat4 projectionMatrix;
+	glm::mat4 viewMatrix;
+	glm::vec3 viewPosition;
+	float pad0;
+};
+
+struct DirLightData {
+	glm::vec3 direction;
+	float pad0;
+	glm::vec3 ambient;
+	float pad1;
+	glm::vec3 diffuse;
+	float pad2;
+	glm::vec3 specular;
+	float pad3;
+};
+
+//every float is packed into the padding of the vec3 in front of it
+struct PointLightData {
+	glm::vec3 position;
+	float constant;
+	glm::vec3 ambient;
+	float linear;
+	glm::vec3 diffuse;
+	float quadratic;
+	glm::vec3 specular;
+	float pad0;
+};
+
+struct SpotLightData {
+	glm::vec3 position;
+	float constant;
+	glm::vec3 direction;
+	float linear;
+	glm::vec3 ambient;
+	float quadratic;
+	glm::vec3 diffuse;
+	float cutOff;
+	glm::vec3 specular;
+	float outerCutOff;
+};
+
+const unsigned int MAX_POINT_LIGHTS = 4;		//has to match NR_POINT_LIGHTS in the fragment shaders
+
+struct LightsBlock {
+	DirLightData dirLight;
+	PointLightData pointLights[MAX_POINT_LIGHTS];
+	SpotLightData spotLight;
+};
+
+static_assert(sizeof(FrameDataBlock) == 144, "FrameDataBlock does not match the std140 layout");
+static_assert(sizeof(PointLightData) == 64, "PointLightData does not match the std140 layout");
+static_assert(sizeof(SpotLightData) == 80, "SpotLightData does not match the std140 layout");
+static_assert(sizeof(LightsBlock) == 400, "LightsBlock does not match the std140 layout");
+
+//a uniform block shared by every program through one binding point, its data streamed once per frame
+class UniformBuffer {
+public:
+	unsigned int binding;
+	GLsizeiptr size;
+
+	UniformBuffer(GLsizeiptr size, unsigned int binding) : binding(binding), size(size) {}
+
+	//writing the whole block into this frame's stream region and pointing the binding at it
+	void update(const void* data)
+	{
+		StreamBuffer& stream = StreamBuffer::get();
+		StreamBuffer::Allocation allocation = stream.write(data, size, stream.uniformAlignment());
+		GLState::bindBufferRange(GL_UNIFORM_BUFFER, binding, allocation.bufferID, allocation.offset, size);
+	}
+};
+
+#endif
@@ -0,0 +1,169 @@
+#pragma once
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+#include "GLState.h"
+
+struct Vertex {
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 texture;
+};
+
+//compact 16 byte vertex: snorm16 position inside the mesh bounds, 2_10_10_10 normal and half float UVs
+struct PackedVertex {
+	short position[3];
+	short padding;
+	unsigned int normal;			//GL_INT_2_10_10_10_REV
+	unsigned short texture[2];		//GL_HALF_FLOAT
+};
+
+//how a mesh's vertices are laid out on the GPU
+enum vertex_format {
+	VERTEX_FORMAT_FULL,				//Vertex, 32 bytes of floats
+	VERTEX_FORMAT_PACKED			//PackedVertex, 16 bytes
+};
+
+//size of one vertex on the GPU
+inline unsigned int vertexStride(vertex_format format)
+{
+	return format == VERTEX_FORMAT_PACKED ? sizeof(PackedVertex) : sizeof(Vertex);
+}
+
+//pointing the attributes of the bound VAO at the bound array buffer
+inline void setupVertexAttributes(vertex_format format)
+{
+	if (format == VERTEX_FORMAT_PACKED) {
+		//quantized positions (normalized to -1..1)
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+		//normals (normalized to -1..1, w is ignored)
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+		//half float textures
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texture));
+		return;
+	}
+
+	//vertex positions
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+	//vertex normals
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));			//offsetof(s, m) where s = struct, m = variable member
+	//vertex textures
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texture));
+}
+
+//per instance transform read by the INSTANCED vertex permutation
+struct InstanceTransform {
+	glm::mat4 modelMatrix;			//attributes 3 - 6
+	glm::vec4 normalMatrix[3];		//attributes 7 - 9, columns of the inverse transpose (w unused)
+
+	InstanceTransform() {}
+
+	InstanceTransform(const glm::mat4& modelMatrix)
+	{
+		this->modelMatrix = modelMatrix;
+		glm::mat3 normal = glm::transpose(glm::inverse(glm::mat3(modelMatrix)));
+		for (int i = 0; i < 3; i++)
+			normalMatrix[i] = glm::vec4(normal[i], 0.0f);
+	}
+};
+
+//remembers which instance data every VAO's INSTANCED attributes point at, so batches sharing a VAO only re-point them
+//on a change. attributes 10 and 11 decode packed positions, either streamed per instance or as one constant value
+class InstanceAttributes {
+public:
+	//points the bound VAO's instance attributes at buffer + byteOffset, dequantizationOffset being where the scale
+	//and offset vec4s sit in each stride (0 when they come from setDequantization instead)
+	static void point(unsigned int VAO, unsigned int buffer, size_t byteOffset, unsigned int stride, size_t dequantizationOffset)
+	{
+		Binding* binding = NULL;
+		std::vector<Binding>& bindings = m_Bindings();
+		for (unsigned int i = 0; i < bindings.size(); i++) {
+			if (bindings[i].VAO == VAO)
+				binding = &bindings[i];
+		}
+		if (!binding) {
+			Binding added;
+			added.VAO = VAO;
+			bindings.push_back(added);
+			binding = &bindings.back();
+			for (unsigned int location = 3; location <= 9; location++) {
+				glEnableVertexAttribArray(location);
+				glVertexAttribDivisor(location, 1);
+			}
+			glVertexAttribDivisor(10, 1);
+			glVertexAttribDivisor(11, 1);
+		}
+		if (binding->buffer == buffer && binding->byteOffset == byteOffset && binding->stride == stride && binding->dequantizationOffset == dequantizationOffset)
+			return;
+
+		GLState::bindBuffer(GL_ARRAY_BUFFER, buffer);
+		for (unsigned int column = 0; column < 4; column++)
+			glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, stride, (void*)(byteOffset + offsetof(InstanceTransform, modelMatrix) + column * sizeof(glm::vec4)));
+		for (unsigned int column = 0; column < 3; column++)
+			glVertexAttribPointer(7 + column, 3, GL_FLOAT, GL_FALSE, stride, (void*)(byteOffset + offsetof(InstanceTransform, normalMatrix) + column * sizeof(glm::vec4)));
+
+		if (dequantizationOffset) {
+			glVertexAttribPointer(10, 4, GL_FLOAT, GL_FALSE, stride, (void*)(byteOffset + dequantizationOffset));
+			glVertexAttribPointer(11, 4, GL_FLOAT, GL_FALSE, stride, (void*)(byteOffset + dequantizationOffset + sizeof(glm::vec4)));
+		}
+		if (binding->dequantizationOffset == UNKNOWN || (binding->dequantizationOffset != 0) != (dequantizationOffset != 0)) {
+			if (dequantizationOffset) {
+				glEnableVertexAttribArray(10);
+				glEnableVertexAttribArray(11);
+			}
+			else {
+				glDisableVertexAttribArray(10);
+				glDisableVertexAttribArray(11);
+			}
+		}
+
+		binding->buffer = buffer;
+		binding->byteOffset = byteOffset;
+		binding->stride = stride;
+		binding->dequantizationOffset = dequantizationOffset;
+	}
+
+	//forgetting every binding, for when a buffer they could point at got deleted
+	static void invalidate()
+	{
+		m_Bindings().clear();
+	}
+
+	//the value attributes 10 and 11 read while their arrays are disabled (current attribute values are context state)
+	static void setDequantization(const glm::vec3& positionScale, const glm::vec3& positionOffset)
+	{
+		glVertexAttrib4f(10, positionScale.x, positionScale.y, positionScale.z, 0.0f);
+		glVertexAttrib4f(11, positionOffset.x, positionOffset.y, positionOffset.z, 0.0f);
+	}
+
+private:
+	static const size_t UNKNOWN = (size_t)-1;
+
+	struct Binding {
+		unsigned int VAO = 0;
+		unsigned int buffer = 0;
+		size_t byteOffset = UNKNOWN;
+		unsigned int stride = 0;
+		size_t dequantizationOffset = UNKNOWN;
+	};
+
+	static std::vector<Binding>& m_Bindings()
+	{
+		static std::vector<Binding> s_bindings;
+		return s_bindings;
+	}
+};
+
+#endif